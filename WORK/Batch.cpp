@@ -0,0 +1,211 @@
+//      .
+//
+//   work_batch --recipe edit.txt --output out/ [--threads N] [--format jpg] [--quality 95] input...
+//
+// input -     .   -   (TaskScheduler):
+//     ,     ,   
+//       --threads ,  .
+//  --tile-rows N  PGM/PPM    N   
+//   ,    PPM ( PGM,   ).
+// --trace FILE      Chrome trace events     .
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "Export.h"
+#include "ImageLoader.h"
+#include "Recipe.h"
+#include "TaskScheduler.h"
+#include "Tiled.h"
+#include "Trace.h"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+    struct BatchOptions {
+        std::string recipePath;
+        std::string outputDir;
+        std::string format; //  -   
+        int quality = 95;
+        int threads = 0;
+        int tileRows = 0; // 0 -     
+        std::string tracePath;
+        std::vector<std::string> inputs;
+    };
+
+    void printUsage() {
+        std::cerr << "Usage: work_batch --recipe FILE --output DIR [--threads N] [--format EXT] [--quality Q] [--tile-rows N] [--trace FILE] INPUT...\n";
+    }
+
+    bool parseArguments(int argc, char** argv, BatchOptions& options) {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--recipe" && hasValue) options.recipePath = argv[++i];
+            else if (arg == "--output" && hasValue) options.outputDir = argv[++i];
+            else if (arg == "--format" && hasValue) options.format = argv[++i];
+            else if (arg == "--quality" && hasValue) options.quality = std::stoi(argv[++i]);
+            else if (arg == "--threads" && hasValue) options.threads = std::stoi(argv[++i]);
+            else if (arg == "--tile-rows" && hasValue) options.tileRows = std::stoi(argv[++i]);
+            else if (arg == "--trace" && hasValue) options.tracePath = argv[++i];
+            else if (arg.compare(0, 2, "--") == 0) return false;
+            else options.inputs.push_back(arg);
+        }
+        return !options.recipePath.empty() && !options.outputDir.empty() && !options.inputs.empty();
+    }
+
+    bool isImageFile(const fs::path& path) {
+        std::string ext = path.extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        static const char* known[] = { ".jpg", ".jpeg", ".png", ".bmp", ".tif", ".tiff", ".webp", ".ppm", ".pgm" };
+        return std::find(std::begin(known), std::end(known), ext) != std::end(known);
+    }
+
+    //      
+    std::vector<fs::path> collectInputs(const std::vector<std::string>& inputs) {
+        std::vector<fs::path> files;
+        for (const std::string& input : inputs) {
+            if (fs::is_directory(input)) {
+                for (const fs::directory_entry& entry : fs::directory_iterator(input)) {
+                    if (entry.is_regular_file() && isImageFile(entry.path())) {
+                        files.push_back(entry.path());
+                    }
+                }
+            }
+            else {
+                files.push_back(input);
+            }
+        }
+        std::sort(files.begin(), files.end());
+        return files;
+    }
+
+    //     :      --format
+    fs::path outputPathFor(const fs::path& input, const BatchOptions& options) {
+        fs::path output = fs::path(options.outputDir) / input.filename();
+        if (options.tileRows > 0) {
+            output.replace_extension(".ppm");
+        }
+        else if (!options.format.empty()) {
+            output.replace_extension("." + options.format);
+        }
+        return output;
+    }
+
+    //              
+    bool checkOutputCollisions(const std::vector<fs::path>& files, const BatchOptions& options) {
+        std::map<fs::path, fs::path> owners;
+        bool unique = true;
+        for (const fs::path& input : files) {
+            auto inserted = owners.emplace(outputPathFor(input, options), input);
+            if (!inserted.second) {
+                std::cerr << input.string() << " and " << inserted.first->second.string() << " would both be written to "
+                    << inserted.first->first.string() << "\n";
+                unique = false;
+            }
+        }
+        return unique;
+    }
+}
+
+int main(int argc, char** argv) {
+    BatchOptions options;
+    bool parsed = false;
+    try {
+        parsed = parseArguments(argc, argv, options);
+    }
+    catch (const std::exception&) {
+        parsed = false; //   --threads  --quality
+    }
+    if (!parsed) {
+        printUsage();
+        return 2;
+    }
+
+    if (!options.tracePath.empty()) {
+        Tracer::instance().startTrace(options.tracePath);
+    }
+
+    Recipe recipe;
+    std::vector<OverlayLayer> overlays;
+    try {
+        recipe = Recipe::load(options.recipePath);
+        overlays = recipe.loadOverlays();
+        if (options.tileRows > 0 && (!overlays.empty() || recipe.params.scaleFactor != 1.0)) {
+            throw std::runtime_error("Overlay and scale are not supported with --tile-rows");
+        }
+        fs::create_directories(options.outputDir);
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    ExportSettings encoding;
+    encoding.jpegQuality = options.quality;
+    encoding.pngCompression = 1; //   
+
+    std::vector<fs::path> files = collectInputs(options.inputs);
+    if (!checkOutputCollisions(files, options)) {
+        return 1;
+    }
+    TaskScheduler::install(options.threads); //  cv::parallel_for_     
+    int threadCount = TaskScheduler::instance().threadCount();
+
+    std::atomic<int> failed(0);
+    std::mutex logMutex;
+    auto start = std::chrono::steady_clock::now();
+
+    auto process = [&](const fs::path& input) {
+        try {
+            if (options.tileRows > 0) {
+                processTiled(input.string(), outputPathFor(input, options).string(), recipe.createChain(), options.tileRows);
+                return;
+            }
+
+            cv::Mat image = decodeImageFile(input.string()); //      
+            if (image.empty()) {
+                throw std::runtime_error("failed to load image");
+            }
+            cv::Mat result = recipe.apply(image, overlays);
+
+            fs::path output = outputPathFor(input, options);
+            std::string ext = output.extension().string();
+            TRACE_SCOPE("batch.encode");
+            if (!cv::imwrite(output.string(), encodableImage(result, ext), encoderParams(ext, encoding))) {
+                throw std::runtime_error("failed to write " + output.string());
+            }
+        }
+        catch (const std::exception& e) {
+            failed++;
+            std::lock_guard<std::mutex> lock(logMutex);
+            std::cerr << input.string() << ": " << e.what() << "\n";
+        }
+    };
+
+    {
+        TaskGroup images;
+        for (const fs::path& input : files) {
+            images.run([&process, &input] { process(input); });
+        }
+        images.wait();
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    size_t done = files.size() - failed;
+    std::cout << done << " images in " << seconds << " s (" << (seconds > 0 ? done / seconds : 0.0)
+        << " images/s, " << threadCount << " threads)\n";
+    if (!options.tracePath.empty()) {
+        Tracer::instance().printStats(std::cerr);
+        Tracer::instance().writeTrace();
+    }
+    return failed > 0 ? 1 : 0;
+}
@@ -0,0 +1,376 @@
+//         .
+//
+//   work_bench [--sizes 1,4,16,50,100] [--threads 1,4,8] [--repeat 5] [--only NAME]
+//              [--csv results.csv] [--baseline previous.csv] [--trace trace.json]
+//
+//             .
+// --csv     , --baseline    
+//  (,   )   . --trace  
+//     (Chrome trace events);     .
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "ColorKernel.h"
+#include "Convolution.h"
+#include "FilterChain.h"
+#include "Filters.h"
+#include "Palette.h"
+#include "Pipeline.h"
+#include "Statistics.h"
+#include "TaskScheduler.h"
+#include "Trace.h"
+
+namespace {
+
+    struct BenchOptions {
+        std::vector<double> sizes = { 1, 4, 16 }; // 
+        std::vector<int> threads;
+        int repeat = 5;
+        std::string only;
+        std::string csvPath;
+        std::string baselinePath;
+        std::string tracePath;
+    };
+
+    struct BenchCase {
+        std::string name;
+        //       
+        std::function<void(const cv::Mat& input, cv::Mat& work)> prepare;
+        std::function<void(cv::Mat& work)> run;
+    };
+
+    struct BenchResult {
+        std::string name;
+        double megapixels;
+        int threads;
+        double medianMs;
+        double mpPerSecond;
+    };
+
+    std::vector<std::string> splitList(const std::string& text) {
+        std::vector<std::string> items;
+        std::stringstream stream(text);
+        std::string item;
+        while (std::getline(stream, item, ',')) {
+            if (!item.empty()) {
+                items.push_back(item);
+            }
+        }
+        return items;
+    }
+
+    bool parseArguments(int argc, char** argv, BenchOptions& options) {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (i + 1 >= argc) {
+                return false;
+            }
+            std::string value = argv[++i];
+            if (arg == "--sizes") {
+                options.sizes.clear();
+                for (const std::string& item : splitList(value)) options.sizes.push_back(std::stod(item));
+            }
+            else if (arg == "--threads") {
+                options.threads.clear();
+                for (const std::string& item : splitList(value)) options.threads.push_back(std::stoi(item));
+            }
+            else if (arg == "--repeat") options.repeat = std::max(1, std::stoi(value));
+            else if (arg == "--only") options.only = value;
+            else if (arg == "--csv") options.csvPath = value;
+            else if (arg == "--baseline") options.baselinePath = value;
+            else if (arg == "--trace") options.tracePath = value;
+            else return false;
+        }
+        return true;
+    }
+
+    //  :    ,     
+    cv::Mat makeImage(double megapixels, unsigned seed) {
+        int width = static_cast<int>(std::sqrt(megapixels * 1e6 * 4.0 / 3.0));
+        int height = static_cast<int>(megapixels * 1e6 / width);
+        cv::Mat image(height, width, CV_8UC3);
+        for (int y = 0; y < height; y++) {
+            cv::Vec3b* row = image.ptr<cv::Vec3b>(y);
+            for (int x = 0; x < width; x++) {
+                row[x] = cv::Vec3b(static_cast<uchar>(x * 255 / width), static_cast<uchar>(y * 255 / height),
+                    static_cast<uchar>((x + y) * 127 / (width + height) + 64));
+            }
+        }
+        cv::Mat noise(height, width, CV_8UC3);
+        cv::theRNG().state = seed;
+        cv::randu(noise, cv::Scalar::all(0), cv::Scalar::all(32));
+        cv::add(image, noise, image);
+        return image;
+    }
+
+    std::vector<BenchCase> makeCases(const std::vector<OverlayLayer>& overlays) {
+        std::vector<BenchCase> cases;
+        auto copyInput = [](const cv::Mat& input, cv::Mat& work) { input.copyTo(work); };
+        auto addFilter = [&](const std::string& name, std::function<std::unique_ptr<Filter>()> create) {
+            cases.push_back({ "filter." + name, copyInput, [create](cv::Mat& work) { create()->apply(work); } });
+        };
+        addFilter("grayscale", [] { return std::make_unique<GrayscaleFilter>(); });
+        for (int radius : { 7, 25, 50, 100, 200 }) {
+            addFilter("blur_r" + std::to_string(radius), [radius] { return std::make_unique<BlurFilter>(radius); });
+        }
+        addFilter("sharpen", [] { return std::make_unique<SharpenFilter>(); });
+        addFilter("invert", [] { return std::make_unique<InvertFilter>(); });
+        addFilter("mirror", [] { return std::make_unique<MirrorFilter>(); });
+
+        //        ,     (  )
+        auto addPooled = [&](const std::string& name, std::function<std::unique_ptr<Filter>()> create) {
+            std::shared_ptr<BufferPool> pool = std::make_shared<BufferPool>();
+            cases.push_back({ "filter." + name + ".pooled", copyInput, [create, pool](cv::Mat& work) { create()->apply(work, *pool); } });
+        };
+        addPooled("grayscale", [] { return std::make_unique<GrayscaleFilter>(); });
+        addPooled("blur_r7", [] { return std::make_unique<BlurFilter>(7); });
+        addPooled("blur_r50", [] { return std::make_unique<BlurFilter>(50); });
+        addPooled("sharpen", [] { return std::make_unique<SharpenFilter>(); });
+
+        //       HSV -      
+        cases.push_back({ "color.legacy_hsv", copyInput, [](cv::Mat& work) {
+            work.convertTo(work, -1, 1.2, 0);
+            cv::Mat hsv;
+            cv::cvtColor(work, hsv, cv::COLOR_BGR2HSV);
+            for (int y = 0; y < hsv.rows; y++) {
+                for (int x = 0; x < hsv.cols; x++) {
+                    cv::Vec3b& pixel = hsv.at<cv::Vec3b>(y, x);
+                    pixel[1] = cv::saturate_cast<uchar>(pixel[1] * 0.8);
+                }
+            }
+            cv::cvtColor(hsv, work, cv::COLOR_HSV2BGR);
+            } });
+        cases.push_back({ "color.brightness_saturation", copyInput, [](cv::Mat& work) {
+            applyColorAdjustment(work, work, ColorAdjustment(1.2, 0.8, 0, 0, 0));
+            } });
+        cases.push_back({ "color.rgb", copyInput, [](cv::Mat& work) {
+            applyColorAdjustment(work, work, ColorAdjustment(1.0, 1.0, 20, -10, 5));
+            } });
+        cases.push_back({ "overlay.blend", [](const cv::Mat& input, cv::Mat& work) { work = input; },
+            [overlays](cv::Mat& work) {
+                AdjustmentParams params;
+                cv::Mat result;
+                RenderPipeline::renderFullResolution(work, overlays, params, result);
+            } });
+        //  :     ,    
+        auto compositor = std::make_shared<OverlayCompositor>();
+        compositor->setLayers(overlays);
+        cases.push_back({ "overlay.cached", [](const cv::Mat& input, cv::Mat& work) { work = input; },
+            [compositor](cv::Mat& work) {
+                cv::Mat result;
+                compositor->composite(work, 1.0, result);
+            } });
+
+        //    1280x720   :      3 .
+        //      ,       
+        for (double zoom : { 1.0, 3.0 }) {
+            auto pipeline = std::make_shared<RenderPipeline>();
+            auto source = std::make_shared<cv::Mat>();
+            pipeline->setViewportSize(cv::Size(1280, 720));
+            pipeline->setScale(zoom);
+            cases.push_back({ zoom == 1.0 ? "render.view_fit" : "render.view_zoom300",
+                [pipeline, source](const cv::Mat& input, cv::Mat& work) {
+                    if (source->data != input.data) {
+                        *source = input;
+                        pipeline->setSource(input);
+                    }
+                    pipeline->setBrightness(pipeline->getParams().brightness == 1.1 ? 1.2 : 1.1);
+                    work = input;
+                },
+                [pipeline](cv::Mat&) { pipeline->render(); } });
+        }
+
+        //  :     
+        auto makeRecipe = [] {
+            std::vector<std::unique_ptr<Filter>> chain;
+            chain.push_back(std::make_unique<MirrorFilter>());
+            chain.push_back(std::make_unique<InvertFilter>());
+            chain.push_back(std::make_unique<GrayscaleFilter>());
+            chain.push_back(std::make_unique<SharpenFilter>());
+            chain.push_back(std::make_unique<InvertFilter>());
+            chain.push_back(std::make_unique<ColorAdjustmentFilter>(ColorAdjustment(1.1, 1.0, 10, 0, -10)));
+            return chain;
+        };
+        cases.push_back({ "chain.sequential", copyInput, [makeRecipe](cv::Mat& work) {
+            for (const std::unique_ptr<Filter>& filter : makeRecipe()) {
+                filter->apply(work);
+            }
+            } });
+        cases.push_back({ "chain.fused", copyInput, [makeRecipe](cv::Mat& work) { FilterChain(makeRecipe()).apply(work); } });
+        //         :   ,   filter.blur_r7  filter.sharpen
+        auto toGray = [](const cv::Mat& input, cv::Mat& work) { cv::cvtColor(input, work, cv::COLOR_BGR2GRAY); };
+        cases.push_back({ "gray.blur", toGray, [](cv::Mat& work) { BlurFilter(7).apply(work); } });
+        cases.push_back({ "gray.sharpen", toGray, [](cv::Mat& work) { SharpenFilter().apply(work); } });
+        //        ( 2,    ):
+        //   ,       ; auto -  ConvolutionFilter
+        for (int size : { 5, 15, 31, 63 }) {
+            cv::Mat gaussian = cv::getGaussianKernel(size, size / 6.0, CV_32F);
+            cv::Mat wide = cv::getGaussianKernel(size, size / 3.0, CV_32F);
+            cv::Mat kernel = 2 * gaussian * gaussian.t() - wide * wide.t();
+            static const char* const strategies[] = { "auto", "direct", "separable", "fft" };
+            for (int strategy = CONVOLUTION_AUTO; strategy <= CONVOLUTION_FFT; strategy++) {
+                auto filter = std::make_shared<ConvolutionFilter>(kernel, static_cast<ConvolutionStrategy>(strategy));
+                cases.push_back({ std::string("convolution.") + strategies[strategy] + "_k" + std::to_string(size), copyInput,
+                    [filter](cv::Mat& work) { filter->apply(work); } });
+            }
+        }
+        cases.push_back({ "palette.extract", [](const cv::Mat& input, cv::Mat& work) { work = input; },
+            [](cv::Mat& work) { Palette::extractPalette(work, 5); } });
+        cases.push_back({ "statistics.full", [](const cv::Mat& input, cv::Mat& work) { work = input; },
+            [](cv::Mat& work) { StatisticsEngine::measure(work); } });
+        //   ,    256x256
+        auto engine = std::make_shared<StatisticsEngine>();
+        cases.push_back({ "statistics.update_tile", [engine](const cv::Mat& input, cv::Mat& work) {
+            work = input;
+            engine->statistics(work);
+            },
+            [engine](cv::Mat& work) { engine->update(work, { cv::Rect(0, 0, 256, 256) }); } });
+        return cases;
+    }
+
+    double measure(const BenchCase& benchCase, const cv::Mat& input, int repeat) {
+        std::vector<double> times;
+        cv::Mat work;
+        for (int i = 0; i < repeat; i++) {
+            benchCase.prepare(input, work);
+            auto start = std::chrono::steady_clock::now();
+            benchCase.run(work);
+            times.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+        }
+        std::sort(times.begin(), times.end());
+        return times[times.size() / 2];
+    }
+
+    std::string resultKey(const std::string& name, double megapixels, int threads) {
+        std::ostringstream key;
+        key << name << "," << megapixels << "," << threads;
+        return key.str();
+    }
+
+    //   :  ",," -> , 
+    std::map<std::string, double> loadBaseline(const std::string& path) {
+        std::map<std::string, double> baseline;
+        std::ifstream file(path);
+        std::string line;
+        std::getline(file, line); // 
+        while (std::getline(file, line)) {
+            std::vector<std::string> fields = splitList(line);
+            if (fields.size() >= 4) {
+                baseline[resultKey(fields[0], std::stod(fields[1]), std::stoi(fields[2]))] = std::stod(fields[3]);
+            }
+        }
+        return baseline;
+    }
+}
+
+int main(int argc, char** argv) {
+    BenchOptions options;
+    bool parsed = false;
+    try {
+        parsed = parseArguments(argc, argv, options);
+    }
+    catch (const std::exception&) {
+        parsed = false;
+    }
+    if (!parsed) {
+        std::cerr << "Usage: work_bench [--sizes 1,4,16] [--threads 1,4] [--repeat N] [--only NAME] [--csv FILE] [--baseline FILE] [--trace FILE]\n";
+        return 2;
+    }
+    if (options.threads.empty()) {
+        options.threads = { 1, cv::getNumberOfCPUs() };
+    }
+
+    if (!options.tracePath.empty()) {
+        Tracer::instance().startTrace(options.tracePath);
+    }
+
+    std::map<std::string, double> baseline;
+    if (!options.baselinePath.empty()) {
+        baseline = loadBaseline(options.baselinePath);
+    }
+
+    std::cout << "OpenCV " << CV_VERSION << ", " << cv::getNumberOfCPUs() << " CPUs\n";
+    std::cout << std::left << std::setw(30) << "case" << std::right << std::setw(8) << "MP" << std::setw(9) << "threads"
+        << std::setw(12) << "median ms" << std::setw(10) << "MP/s" << std::setw(12) << "vs base" << "\n";
+
+    std::vector<BenchResult> results;
+    int regressions = 0;
+    for (double megapixels : options.sizes) {
+        cv::Mat input = makeImage(megapixels, 1);
+        //     :      
+        std::vector<OverlayLayer> overlays(2);
+        for (OverlayLayer& layer : overlays) {
+            cv::Mat color = makeImage(0.25, 2);
+            std::vector<cv::Mat> channels;
+            cv::split(color, channels);
+            channels.push_back(channels[0].clone());
+            cv::merge(channels, layer.image);
+            layer.opacity = 0.5;
+        }
+        overlays[1].placement = cv::Rect2d(0.7, 0.7, 0.25, 0.25);
+        std::vector<BenchCase> cases = makeCases(overlays);
+        for (int threads : options.threads) {
+            TaskScheduler::install(threads); //   cv::parallel_for_    threads 
+            for (const BenchCase& benchCase : cases) {
+                if (!options.only.empty() && benchCase.name.find(options.only) == std::string::npos) {
+                    continue;
+                }
+                double actualMp = input.total() / 1e6;
+                double ms = measure(benchCase, input, options.repeat);
+                BenchResult result = { benchCase.name, megapixels, threads, ms, actualMp / (ms / 1000.0) };
+                results.push_back(result);
+
+                std::cout << std::left << std::setw(30) << result.name << std::right << std::setw(8) << megapixels
+                    << std::setw(9) << threads << std::setw(12) << std::fixed << std::setprecision(2) << ms
+                    << std::setw(10) << std::setprecision(1) << result.mpPerSecond;
+                auto previous = baseline.find(resultKey(result.name, megapixels, threads));
+                if (previous != baseline.end()) {
+                    double ratio = previous->second / ms; // > 1 -  
+                    bool slower = ratio < 0.9;
+                    regressions += slower ? 1 : 0;
+                    std::cout << std::setw(11) << std::setprecision(2) << ratio << "x" << (slower ? "  SLOWER" : "");
+                }
+                std::cout << std::defaultfloat << std::setprecision(6) << "\n"; //      MP 
+            }
+        }
+    }
+
+    bool convolutionMeasured = std::any_of(results.begin(), results.end(), [](const BenchResult& result) {
+        return result.name.compare(0, 12, "convolution.") == 0;
+        });
+    if (convolutionMeasured) {
+        // ,  ConvolutionTuning   ,      
+        const ConvolutionTuning& tuning = ConvolutionTuning::instance();
+        int crossover = 3;
+        while (crossover < 255 && tuning.fftEstimate(cv::Size(crossover, crossover)) >= tuning.directEstimate(cv::Size(crossover, crossover))) {
+            crossover += 2;
+        }
+        std::cout << "convolution ns per unit: direct " << tuning.directCost << ", separable " << tuning.separableCost
+            << ", fft " << tuning.fftCost << "; full-rank kernels from " << crossover << "x" << crossover << " go to FFT\n";
+    }
+
+    if (!options.csvPath.empty()) {
+        std::ofstream csv(options.csvPath);
+        csv << "case,megapixels,threads,median_ms,mp_per_s\n";
+        for (const BenchResult& result : results) {
+            csv << result.name << "," << result.megapixels << "," << result.threads << ","
+                << result.medianMs << "," << result.mpPerSecond << "\n";
+        }
+    }
+    if (!options.tracePath.empty()) {
+        Tracer::instance().printStats(std::cout);
+        Tracer::instance().writeTrace();
+    }
+    return regressions > 0 ? 1 : 0;
+}
@@ -0,0 +1,107 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <tuple>
+#include <vector>
+
+//    
+struct BufferPoolStats {
+    size_t hits = 0;           //    
+    size_t misses = 0;         //   
+    size_t bytes = 0;          //     (  )
+    size_t peakBytes = 0;      //   bytes
+    size_t allocatedBytes = 0; //     
+};
+
+//    cv::Mat,     .
+// ,  acquire(),  ,       , 
+//    ,    cv::Mat , -   .
+//   cv::Mat (cv::fastMalloc,  CV_MALLOC_ALIGN),  .
+//      .      .
+class BufferPool {
+public:
+    explicit BufferPool(size_t limitBytes = size_t(512) << 20) : limit(limitBytes) {}
+
+    BufferPool(const BufferPool&) = delete;
+    BufferPool& operator=(const BufferPool&) = delete;
+
+    //      ;   .
+    // allocatedBytes,  ,      (    )
+    cv::Mat acquire(cv::Size size, int type, size_t* allocatedBytes = nullptr) {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<cv::Mat>& bucket = buckets[Key(size.height, size.width, type)];
+        for (const cv::Mat& buffer : bucket) {
+            if (isFree(buffer)) {
+                current.hits++;
+                return buffer;
+            }
+        }
+        cv::Mat buffer(size, type);
+        size_t bytes = buffer.total() * buffer.elemSize();
+        bucket.push_back(buffer);
+        current.misses++;
+        current.bytes += bytes;
+        current.allocatedBytes += bytes;
+        if (allocatedBytes) {
+            *allocatedBytes += bytes;
+        }
+        current.peakBytes = std::max(current.peakBytes, current.bytes);
+        if (current.bytes > limit) {
+            trim(limit);
+        }
+        return buffer;
+    }
+
+    //     (,    )
+    void trim() {
+        std::lock_guard<std::mutex> lock(mutex);
+        trim(0);
+    }
+
+    BufferPoolStats stats() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return current;
+    }
+
+    void printStats(std::ostream& out) const {
+        BufferPoolStats stats = this->stats();
+        size_t requests = stats.hits + stats.misses;
+        out << "buffer pool: " << requests << " requests, " << stats.hits << " hits ("
+            << (requests ? 100 * stats.hits / requests : 0) << "%), " << stats.misses << " allocations, peak "
+            << stats.peakBytes / 1048576.0 << " MB, allocated " << stats.allocatedBytes / 1048576.0 << " MB\n";
+    }
+
+private:
+    typedef std::tuple<int, int, int> Key; // , , 
+
+    //     
+    static bool isFree(const cv::Mat& buffer) {
+        return buffer.u && buffer.u->refcount == 1;
+    }
+
+    //   ,     target
+    void trim(size_t target) {
+        for (auto bucket = buckets.begin(); bucket != buckets.end() && current.bytes > target;) {
+            std::vector<cv::Mat>& buffers = bucket->second;
+            for (size_t i = 0; i < buffers.size() && current.bytes > target;) {
+                if (isFree(buffers[i])) {
+                    current.bytes -= buffers[i].total() * buffers[i].elemSize();
+                    buffers.erase(buffers.begin() + i);
+                }
+                else {
+                    i++;
+                }
+            }
+            bucket = buffers.empty() ? buckets.erase(bucket) : std::next(bucket);
+        }
+    }
+
+    mutable std::mutex mutex;
+    std::map<Key, std::vector<cv::Mat>> buckets;
+    BufferPoolStats current;
+    size_t limit;
+};
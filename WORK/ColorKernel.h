@@ -0,0 +1,152 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+#include <algorithm>
+#include <atomic>
+
+//    : ,    
+struct ColorAdjustment {
+    float brightness = 1.0f;
+    float saturation = 1.0f;
+    float offsets[3] = { 0.0f, 0.0f, 0.0f }; //     BGR
+    bool swapRedBlue = false; //     RGB (   )
+
+    ColorAdjustment() {}
+    ColorAdjustment(double brightnessValue, double saturationValue, int red, int green, int blue)
+        : brightness(static_cast<float>(brightnessValue)), saturation(static_cast<float>(saturationValue)) {
+        offsets[0] = static_cast<float>(blue);
+        offsets[1] = static_cast<float>(green);
+        offsets[2] = static_cast<float>(red);
+    }
+
+    bool isIdentity() const {
+        return !swapRedBlue && brightness == 1.0f && saturation == 1.0f &&
+            offsets[0] == 0.0f && offsets[1] == 0.0f && offsets[2] == 0.0f;
+    }
+};
+
+//   :       .
+//      HSV:     V = max(B, G, R)
+//  S  c' = V - k * (V - c),  k  ,  S <= 1.
+namespace color_kernel {
+
+    //     (     SIMD)
+    inline void adjustPixel(const uchar* src, uchar* dst, const ColorAdjustment& adj) {
+        float c[3];
+        for (int i = 0; i < 3; i++) {
+            c[i] = std::min(src[i] * adj.brightness, 255.0f);
+        }
+        float v = std::max(c[0], std::max(c[1], c[2]));
+        float d = v - std::min(c[0], std::min(c[1], c[2]));
+        float k = adj.saturation;
+        if (k * d > v) {
+            k = v / d; //     1
+        }
+        for (int i = 0; i < 3; i++) {
+            dst[adj.swapRedBlue ? 2 - i : i] = cv::saturate_cast<uchar>(v - k * (v - c[i]) + adj.offsets[i]);
+        }
+    }
+
+#if CV_SIMD
+    struct SimdConstants {
+        cv::v_float32 brightness, saturation, maxValue, epsilon;
+        cv::v_float32 offsets[3];
+
+        explicit SimdConstants(const ColorAdjustment& adj)
+            : brightness(cv::vx_setall_f32(adj.brightness)),
+            saturation(cv::vx_setall_f32(adj.saturation)),
+            maxValue(cv::vx_setall_f32(255.0f)),
+            epsilon(cv::vx_setall_f32(1e-6f)) {
+            for (int i = 0; i < 3; i++) {
+                offsets[i] = cv::vx_setall_f32(adj.offsets[i]);
+            }
+        }
+    };
+
+    //   ,    adjustPixel,   
+    inline void adjustVector(cv::v_float32 c[3], const SimdConstants& k) {
+        for (int i = 0; i < 3; i++) {
+            c[i] = cv::v_min(c[i] * k.brightness, k.maxValue);
+        }
+        cv::v_float32 v = cv::v_max(c[0], cv::v_max(c[1], c[2]));
+        cv::v_float32 d = v - cv::v_min(c[0], cv::v_min(c[1], c[2]));
+        cv::v_float32 limited = v / cv::v_max(d, k.epsilon);
+        cv::v_float32 factor = cv::v_select(k.saturation * d > v, limited, k.saturation);
+        cv::v_float32 base = v - factor * v;
+        for (int i = 0; i < 3; i++) {
+            c[i] = cv::v_muladd(factor, c[i], base + k.offsets[i]);
+        }
+    }
+
+    inline void expandToFloat(const cv::v_uint8& src, cv::v_float32 dst[4]) {
+        cv::v_uint16 lo, hi;
+        cv::v_expand(src, lo, hi);
+        cv::v_uint32 q0, q1, q2, q3;
+        cv::v_expand(lo, q0, q1);
+        cv::v_expand(hi, q2, q3);
+        dst[0] = cv::v_cvt_f32(cv::v_reinterpret_as_s32(q0));
+        dst[1] = cv::v_cvt_f32(cv::v_reinterpret_as_s32(q1));
+        dst[2] = cv::v_cvt_f32(cv::v_reinterpret_as_s32(q2));
+        dst[3] = cv::v_cvt_f32(cv::v_reinterpret_as_s32(q3));
+    }
+
+    inline cv::v_uint8 packToUchar(const cv::v_float32 src[4]) {
+        cv::v_uint16 lo = cv::v_pack_u(cv::v_round(src[0]), cv::v_round(src[1]));
+        cv::v_uint16 hi = cv::v_pack_u(cv::v_round(src[2]), cv::v_round(src[3]));
+        return cv::v_pack(lo, hi); //      0..255
+    }
+#endif
+
+    //   BGR ( - BGR  RGB); src  dst  
+    inline void adjustRow(const uchar* src, uchar* dst, int width, const ColorAdjustment& adj) {
+        int x = 0;
+#if CV_SIMD
+        const int lanes = cv::v_uint8::nlanes;
+        const int quarter = cv::v_float32::nlanes;
+        SimdConstants constants(adj);
+        for (; x <= width - lanes; x += lanes) {
+            cv::v_uint8 channels[3];
+            cv::v_load_deinterleave(src + 3 * x, channels[0], channels[1], channels[2]);
+
+            cv::v_float32 planes[3][4];
+            for (int i = 0; i < 3; i++) {
+                expandToFloat(channels[i], planes[i]);
+            }
+            for (int q = 0; q < lanes / quarter; q++) {
+                cv::v_float32 pixel[3] = { planes[0][q], planes[1][q], planes[2][q] };
+                adjustVector(pixel, constants);
+                for (int i = 0; i < 3; i++) {
+                    planes[i][q] = pixel[i];
+                }
+            }
+            for (int i = 0; i < 3; i++) {
+                channels[i] = packToUchar(planes[i]);
+            }
+            if (adj.swapRedBlue) {
+                std::swap(channels[0], channels[2]);
+            }
+            cv::v_store_interleave(dst + 3 * x, channels[0], channels[1], channels[2]);
+        }
+        cv::vx_cleanup();
+#endif
+        for (; x < width; x++) {
+            adjustPixel(src + 3 * x, dst + 3 * x, adj);
+        }
+    }
+}
+
+//     CV_8UC3 (  ).
+//   cancel   .
+inline void applyColorAdjustment(const cv::Mat& src, cv::Mat& dst, const ColorAdjustment& adj,
+    const std::atomic<bool>* cancel = nullptr) {
+    CV_Assert(src.type() == CV_8UC3);
+    dst.create(src.size(), src.type());
+    cv::parallel_for_(cv::Range(0, src.rows), [&](const cv::Range& range) {
+        for (int y = range.start; y < range.end; y++) {
+            if (cancel && cancel->load(std::memory_order_relaxed)) {
+                return;
+            }
+            color_kernel::adjustRow(src.ptr<uchar>(y), dst.ptr<uchar>(y), src.cols, adj);
+        }
+        });
+}
@@ -0,0 +1,321 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "Filters.h"
+#include "Trace.h"
+
+//   (. ConvolutionFilter)
+enum ConvolutionStrategy {
+    CONVOLUTION_AUTO,      //     ConvolutionTuning
+    CONVOLUTION_DIRECT,    // cv::filter2D
+    CONVOLUTION_SEPARABLE, //      SVD
+    CONVOLUTION_FFT        //   DFT
+};
+
+//  ,    : kernel ~  column * row
+struct SeparableKernel {
+    std::vector<cv::Mat> rows;    // 1 x width, CV_32F
+    std::vector<cv::Mat> columns; // height x 1, CV_32F
+    int rank() const { return static_cast<int>(rows.size()); }
+};
+
+namespace convolution_kernel {
+    //   SVD    ,      
+    //  tolerance  ( ).   maxRank -  
+    inline SeparableKernel decompose(const cv::Mat& kernel, int maxRank, double tolerance) {
+        cv::Mat k64, w, u, vt;
+        kernel.convertTo(k64, CV_64F);
+        cv::SVD::compute(k64, w, u, vt);
+        double total = 0;
+        for (int i = 0; i < w.rows; i++) {
+            total += w.at<double>(i) * w.at<double>(i);
+        }
+        //  ,        
+        int rank = w.rows;
+        double tail = 0;
+        while (rank > 1) {
+            double next = tail + w.at<double>(rank - 1) * w.at<double>(rank - 1);
+            if (next > tolerance * tolerance * total) {
+                break;
+            }
+            tail = next;
+            rank--;
+        }
+        SeparableKernel separable;
+        if (rank > maxRank) {
+            return separable;
+        }
+        for (int i = 0; i < rank; i++) {
+            double scale = std::sqrt(w.at<double>(i));
+            cv::Mat column, row;
+            u.col(i).convertTo(column, CV_32F, scale);
+            vt.row(i).convertTo(row, CV_32F, scale);
+            separable.columns.push_back(column);
+            separable.rows.push_back(row);
+        }
+        return separable;
+    }
+
+    //  ;       float    
+    inline void convolveSeparable(const cv::Mat& src, cv::Mat& dst, const SeparableKernel& kernel, cv::Point anchor) {
+        if (kernel.rank() == 1) {
+            cv::sepFilter2D(src, dst, -1, kernel.rows[0], kernel.columns[0], anchor);
+            return;
+        }
+        cv::Mat sum, term;
+        for (int i = 0; i < kernel.rank(); i++) {
+            cv::sepFilter2D(src, i == 0 ? sum : term, CV_32F, kernel.rows[i], kernel.columns[i], anchor);
+            if (i > 0) {
+                cv::add(sum, term, sum);
+            }
+        }
+        sum.convertTo(dst, src.depth());
+    }
+
+    //   DFT    tile   kernelSize
+    inline cv::Size fftSize(int tile, cv::Size kernelSize) {
+        return cv::Size(cv::getOptimalDFTSize(tile + kernelSize.width - 1), cv::getOptimalDFTSize(tile + kernelSize.height - 1));
+    }
+
+    //   DFT    tile x tile (overlap-save):   
+    //       ,      ,
+    //       DFT,      .
+    //   cv::filter2D,    ,  - BORDER_REFLECT_101
+    inline void convolveFft(const cv::Mat& src, cv::Mat& dst, const cv::Mat& kernel, cv::Point anchor, int tile) {
+        const cv::Size k = kernel.size();
+        const cv::Size dft = fftSize(tile, k);
+        const cv::Size block(dft.width - k.width + 1, dft.height - k.height + 1); //  DFT    
+        cv::Mat padded;
+        cv::copyMakeBorder(src, padded, anchor.y, k.height - 1 - anchor.y, anchor.x, k.width - 1 - anchor.x, cv::BORDER_REFLECT_101);
+
+        cv::Mat kernelSpectrum;
+        {
+            cv::Mat placed = cv::Mat::zeros(dft, CV_32F);
+            kernel.convertTo(placed(cv::Rect(cv::Point(), k)), CV_32F);
+            cv::dft(placed, kernelSpectrum, 0, k.height);
+        }
+
+        cv::Mat result(src.size(), src.type());
+        const int columns = (src.cols + block.width - 1) / block.width;
+        const int tiles = columns * ((src.rows + block.height - 1) / block.height);
+        const int channels = src.channels();
+        cv::parallel_for_(cv::Range(0, tiles), [&](const cv::Range& range) {
+            cv::Mat plane, input(dft, CV_32F), spectrum, output, converted;
+            for (int t = range.start; t < range.end; t++) {
+                const cv::Rect out = cv::Rect((t % columns) * block.width, (t / columns) * block.height, block.width, block.height) &
+                    cv::Rect(cv::Point(), src.size());
+                const cv::Rect in(out.x, out.y, out.width + k.width - 1, out.height + k.height - 1); //   padded
+                for (int c = 0; c < channels; c++) {
+                    if (channels == 1) {
+                        plane = padded(in);
+                    }
+                    else {
+                        cv::extractChannel(padded(in), plane, c);
+                    }
+                    input.setTo(0);
+                    plane.convertTo(input(cv::Rect(cv::Point(), in.size())), CV_32F);
+                    cv::dft(input, spectrum, 0, in.height);
+                    cv::mulSpectrums(spectrum, kernelSpectrum, spectrum, 0, true); //   - 
+                    cv::dft(spectrum, output, cv::DFT_INVERSE | cv::DFT_SCALE | cv::DFT_REAL_OUTPUT, out.height);
+                    if (channels == 1) {
+                        output(cv::Rect(cv::Point(), out.size())).convertTo(result(out), src.depth());
+                    }
+                    else {
+                        output(cv::Rect(cv::Point(), out.size())).convertTo(converted, src.depth());
+                        cv::insertChannel(converted, result(out), c);
+                    }
+                }
+            }
+            });
+        dst = result;
+    }
+}
+
+//              .
+//     instance()      ( ),
+//           
+struct ConvolutionTuning {
+    double directCost = 0.25;    //     cv::filter2D
+    double separableCost = 0.3;  //    
+    double fftCost = 0.6;        //  log2(  DFT)    ,   
+    int maxRank = 4;             //      
+    double rankTolerance = 1e-3; //       
+    int fftTile = 256;           //       DFT
+
+    static ConvolutionTuning& instance() {
+        static ConvolutionTuning tuning = calibrate();
+        return tuning;
+    }
+
+    double directEstimate(cv::Size kernel) const { return directCost * kernel.area(); }
+
+    double separableEstimate(cv::Size kernel, int rank) const {
+        return separableCost * rank * (kernel.width + kernel.height);
+    }
+
+    double fftEstimate(cv::Size kernel) const {
+        const cv::Size dft = convolution_kernel::fftSize(fftTile, kernel);
+        const double useful = static_cast<double>(dft.width - kernel.width + 1) * (dft.height - kernel.height + 1);
+        return fftCost * std::log2(static_cast<double>(dft.area())) * dft.area() / useful;
+    }
+
+    //      8UC3
+    static ConvolutionTuning calibrate() {
+        TRACE_SCOPE("convolution.calibrate");
+        ConvolutionTuning tuning;
+        cv::Mat image(512, 512, CV_8UC3), result;
+        cv::randu(image, cv::Scalar::all(0), cv::Scalar::all(255));
+        const double samples = static_cast<double>(image.total()) * image.channels();
+        auto median = [](const std::function<void()>& run) {
+            std::vector<double> times;
+            for (int i = 0; i < 3; i++) {
+                auto start = std::chrono::steady_clock::now();
+                run();
+                times.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+            }
+            std::sort(times.begin(), times.end());
+            return times[1];
+        };
+
+        // 7x7:  ,  cv::filter2D   ,    DFT
+        cv::Mat direct(7, 7, CV_32F);
+        cv::randu(direct, -1, 1);
+        tuning.directCost = median([&] { cv::filter2D(image, result, -1, direct); }) / (samples * direct.total());
+
+        SeparableKernel separable;
+        separable.rows.push_back(cv::getGaussianKernel(15, 3, CV_32F).t());
+        separable.columns.push_back(cv::getGaussianKernel(15, 3, CV_32F));
+        tuning.separableCost = median([&] {
+            convolution_kernel::convolveSeparable(image, result, separable, cv::Point(7, 7));
+            }) / (samples * 30);
+
+        cv::Mat large(31, 31, CV_32F);
+        cv::randu(large, -1, 1);
+        const double fftTime = median([&] {
+            convolution_kernel::convolveFft(image, result, large, cv::Point(15, 15), tuning.fftTile);
+            }) / samples;
+        tuning.fftCost = 1.0;
+        tuning.fftCost = fftTime / tuning.fftEstimate(large.size());
+        return tuning;
+    }
+};
+
+//     (  cv::filter2D: ,   ,  BORDER_REFLECT_101).
+//        :
+//  -    (  ) -   , O(rank * (w + h))  ;
+//  -   -    cv::filter2D, O(w * h);
+//  -   - DFT   ,       .
+//    -  ConvolutionTuning; work_bench --only convolution    .
+class ConvolutionFilter : public Filter {
+public:
+    using Filter::apply; // apply(image, pool)   
+
+    explicit ConvolutionFilter(const cv::Mat& kernelValues, ConvolutionStrategy requested = CONVOLUTION_AUTO) {
+        if (kernelValues.empty() || kernelValues.channels() != 1) {
+            throw std::runtime_error("Convolution kernel must be a non-empty single-channel matrix");
+        }
+        kernelValues.convertTo(kernel, CV_32F);
+        anchor = cv::Point(kernel.cols / 2, kernel.rows / 2);
+        chooseStrategy(requested);
+    }
+
+    //    (  ),    1
+    static std::unique_ptr<ConvolutionFilter> fromImage(const std::string& path) {
+        cv::Mat image = cv::imread(path, cv::IMREAD_GRAYSCALE | cv::IMREAD_ANYDEPTH);
+        if (image.empty()) {
+            throw std::runtime_error("Failed to load kernel image " + path);
+        }
+        cv::Mat values;
+        image.convertTo(values, CV_32F);
+        double sum = cv::sum(values)[0];
+        if (sum <= 0) {
+            throw std::runtime_error("Kernel image is black: " + path);
+        }
+        values /= sum;
+        std::unique_ptr<ConvolutionFilter> filter = std::make_unique<ConvolutionFilter>(values);
+        filter->source = path;
+        return filter;
+    }
+
+    void apply(cv::Mat& image) override {
+        switch (strategy) {
+        case CONVOLUTION_SEPARABLE:
+            convolution_kernel::convolveSeparable(image, image, separable, anchor);
+            break;
+        case CONVOLUTION_FFT:
+            convolution_kernel::convolveFft(image, image, kernel, anchor, ConvolutionTuning::instance().fftTile);
+            break;
+        default:
+            cv::filter2D(image, image, -1, kernel, anchor);
+            break;
+        }
+    }
+    int haloRadius() const override { return std::max(std::max(anchor.x, kernel.cols - 1 - anchor.x), std::max(anchor.y, kernel.rows - 1 - anchor.y)); }
+    const char* name() const override {
+        static const char* const names[] = { "filter.convolve", "filter.convolve_direct", "filter.convolve_separable", "filter.convolve_fft" };
+        return names[strategy];
+    }
+    // "kernel w h   "  "psf "    
+    std::string spec() const override {
+        if (!source.empty()) {
+            return "psf " + source;
+        }
+        std::ostringstream out;
+        out << "kernel " << kernel.cols << " " << kernel.rows << std::setprecision(9);
+        for (int y = 0; y < kernel.rows; y++) {
+            for (int x = 0; x < kernel.cols; x++) {
+                out << " " << kernel.at<float>(y, x);
+            }
+        }
+        return out.str();
+    }
+    FilterDescription describe() const override {
+        FilterDescription description;
+        description.kind = FilterDescription::KIND_NEIGHBORHOOD;
+        cv::Mat flipped;
+        cv::flip(kernel, flipped, 1);
+        description.mirrorSymmetric = kernel.cols % 2 == 1 && cv::norm(kernel, flipped, cv::NORM_INF) == 0;
+        return description;
+    }
+
+    ConvolutionStrategy chosenStrategy() const { return strategy; }
+    int separableRank() const { return separable.rank(); }
+
+private:
+    void chooseStrategy(ConvolutionStrategy requested) {
+        const ConvolutionTuning& tuning = ConvolutionTuning::instance();
+        if (requested == CONVOLUTION_SEPARABLE || requested == CONVOLUTION_AUTO) {
+            //       ,  
+            int maxRank = requested == CONVOLUTION_SEPARABLE ? std::min(kernel.rows, kernel.cols) : tuning.maxRank;
+            separable = convolution_kernel::decompose(kernel, maxRank, tuning.rankTolerance);
+        }
+        if (requested != CONVOLUTION_AUTO) {
+            strategy = requested;
+            return;
+        }
+        strategy = CONVOLUTION_DIRECT;
+        double best = tuning.directEstimate(kernel.size());
+        if (separable.rank() > 0 && tuning.separableEstimate(kernel.size(), separable.rank()) < best) {
+            strategy = CONVOLUTION_SEPARABLE;
+            best = tuning.separableEstimate(kernel.size(), separable.rank());
+        }
+        if (tuning.fftEstimate(kernel.size()) < best) {
+            strategy = CONVOLUTION_FFT;
+        }
+    }
+
+    cv::Mat kernel; // CV_32F
+    cv::Point anchor;
+    ConvolutionStrategy strategy = CONVOLUTION_DIRECT;
+    SeparableKernel separable;
+    std::string source; //  ,     
+};
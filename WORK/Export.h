@@ -0,0 +1,227 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Overlay.h"
+#include "Pipeline.h"
+#include "PixelFormat.h"
+#include "Tiled.h"
+#include "Trace.h"
+
+//   
+struct ExportSettings {
+    int jpegQuality = 95;     // 0..100
+    bool progressive = false; //  JPEG
+    int pngCompression = 3;   // 0..9:  -  ,   
+    int stripRows = 256;      //  ,   
+};
+
+//   OpenCV   ext (".jpg", ".png", ...)
+inline std::vector<int> encoderParams(const std::string& ext, const ExportSettings& settings) {
+    if (ext == ".jpg" || ext == ".jpeg") {
+        return { cv::IMWRITE_JPEG_QUALITY, settings.jpegQuality, cv::IMWRITE_JPEG_PROGRESSIVE, settings.progressive ? 1 : 0 };
+    }
+    if (ext == ".png") {
+        return { cv::IMWRITE_PNG_COMPRESSION, settings.pngCompression };
+    }
+    if (ext == ".webp") {
+        return { cv::IMWRITE_WEBP_QUALITY, std::max(1, settings.jpegQuality) };
+    }
+    return {};
+}
+
+//     ext: 16      PNG  TIFF,
+//      8  (imwrite      255)
+inline cv::Mat encodableImage(const cv::Mat& image, std::string ext) {
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (image.depth() == CV_8U || ext == ".png" || ext == ".tif" || ext == ".tiff") {
+        return image;
+    }
+    cv::Mat result;
+    image.convertTo(result, CV_8U, 255.0 / 65535.0);
+    return result;
+}
+
+//         .
+//   .       PPM: 
+//     ,      .  OpenCV (JPEG, PNG, ...)
+//   ,         
+//  ,     (    );   ,
+//       (, 16 )  .   
+//   8- BGR,   .
+// progress    ;   cancel  ,
+//      .
+inline void exportImage(const std::string& path, const cv::Mat& image, const std::vector<OverlayLayer>& layers,
+    const AdjustmentParams& params, const ExportSettings& settings,
+    const std::function<void(double fraction)>& progress = nullptr, const std::atomic<bool>* cancel = nullptr) {
+    TRACE_SCOPE("export.image");
+    CV_Assert(isSupportedImageType(image.type()));
+    std::string ext = path.substr(std::min(path.size(), path.find_last_of('.')));
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    const bool streamed = ext == ".ppm" || ext == ".pnm";
+    const bool adjusted = !ColorAdjustment(params.brightness, params.saturation, params.r, params.g, params.b).isIdentity() ||
+        (!layers.empty() && params.transparency > 0);
+    auto cancelled = [&] { return cancel && cancel->load(); };
+
+    cv::Mat result;
+    if (!adjusted && !streamed) {
+        result = image;
+    }
+    else {
+        OverlayCompositor compositor;
+        compositor.setLayers(layers);
+        std::unique_ptr<PnmWriter> writer;
+        if (streamed) {
+            writer = std::make_unique<PnmWriter>(path, image.cols, image.rows, CV_8UC3);
+        }
+        else {
+            result.create(image.size(), CV_8UC3);
+        }
+        const int stripRows = std::max(1, settings.stripRows);
+        cv::Mat buffer; //  PPM,    
+        for (int y = 0; y < image.rows; y += stripRows) {
+            if (cancelled()) {
+                writer.reset();
+                std::remove(path.c_str());
+                throw std::runtime_error("Export cancelled");
+            }
+            cv::Range rows(y, std::min(image.rows, y + stripRows));
+            TRACE_SCOPE("export.strip");
+            if (writer) {
+                cv::Mat strip = buffer;
+                RenderPipeline::renderRows(image, compositor, params, rows, strip);
+                writer->writeRows(strip);
+                if (strip.u != image.u) {
+                    buffer = strip; //    :   
+                }
+            }
+            else {
+                cv::Mat target = result.rowRange(rows);
+                cv::Mat strip = target;
+                RenderPipeline::renderRows(image, compositor, params, rows, strip);
+                if (strip.data != target.data) {
+                    strip.copyTo(target);
+                }
+            }
+            if (progress) {
+                //    -   
+                progress(static_cast<double>(rows.end) / image.rows * (writer ? 1.0 : 0.5));
+            }
+        }
+        if (writer) {
+            return;
+        }
+    }
+
+    TRACE_SCOPE("export.encode");
+    if (!cv::imwrite(path, encodableImage(result, ext), encoderParams(ext, settings))) {
+        throw std::runtime_error("Failed to write " + path);
+    }
+    if (progress) {
+        progress(1.0);
+    }
+}
+
+//     ,       .
+//    .
+class ImageExporter {
+public:
+    //            
+    typedef std::function<void()> UpdateCallback;
+
+    explicit ImageExporter(UpdateCallback callback) : onUpdate(callback) {}
+
+    ~ImageExporter() {
+        cancel = true;
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
+    ImageExporter(const ImageExporter&) = delete;
+    ImageExporter& operator=(const ImageExporter&) = delete;
+
+    //  ;  image      
+    void start(const std::string& path, const cv::Mat& image, const std::vector<OverlayLayer>& layers,
+        const AdjustmentParams& params, const ExportSettings& settings) {
+        if (running) {
+            throw std::runtime_error("Export is already running");
+        }
+        if (thread.joinable()) {
+            thread.join(); //    
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            percent = 0;
+            hasResult = false;
+            error.clear();
+        }
+        running = true;
+        cancel = false;
+        thread = std::thread([this, path, image, layers, params, settings] {
+            std::string message;
+            try {
+                exportImage(path, image, layers, params, settings, [this](double fraction) {
+                    int value = static_cast<int>(fraction * 100);
+                    {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        if (value == percent) {
+                            return;
+                        }
+                        percent = value;
+                    }
+                    onUpdate();
+                    }, &cancel);
+            }
+            catch (const std::exception& e) {
+                message = e.what();
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                error = message;
+                hasResult = true;
+            }
+            running = false;
+            onUpdate();
+            });
+    }
+
+    bool busy() const { return running; }
+
+    //    
+    int progress() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        return percent;
+    }
+
+    //     ( ).
+    // false -       ;      errorMessage
+    bool takeResult(std::string& errorMessage) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!hasResult) {
+            return false;
+        }
+        errorMessage = error;
+        hasResult = false;
+        return true;
+    }
+
+private:
+    UpdateCallback onUpdate;
+    mutable std::mutex mutex;
+    int percent = 0;
+    bool hasResult = false;
+    std::string error;
+    std::atomic<bool> running{ false };
+    std::atomic<bool> cancel{ false };
+    std::thread thread;
+};
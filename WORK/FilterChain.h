@@ -0,0 +1,309 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <memory>
+#include <vector>
+#include "ColorKernel.h"
+#include "Filters.h"
+#include "PixelFormat.h"
+#include "Trace.h"
+
+//  ,   RGB   
+class ColorAdjustmentFilter : public Filter {
+public:
+    using Filter::apply; // apply(image, pool)   
+
+    explicit ColorAdjustmentFilter(const ColorAdjustment& adjustment) : adjustment(adjustment) {}
+
+    void apply(cv::Mat& image) override {
+        if (!adjustment.isIdentity()) {
+            if (image.type() != CV_8UC3) {
+                //     ; 16    8
+                cv::Mat colored;
+                expandToBgr8(image, colored);
+                image = colored;
+            }
+            applyColorAdjustment(image, image, adjustment);
+        }
+    }
+    const char* name() const override { return "filter.color"; }
+
+    FilterDescription describe() const override {
+        FilterDescription description;
+        if (adjustment.saturation == 1.0f) {
+            //    :    
+            description.kind = FilterDescription::KIND_LUT;
+            description.lut.create(1, 256, CV_8UC3);
+            for (int v = 0; v < 256; v++) {
+                uchar gray[3] = { static_cast<uchar>(v), static_cast<uchar>(v), static_cast<uchar>(v) };
+                color_kernel::adjustPixel(gray, description.lut.ptr<uchar>() + 3 * v, adjustment);
+            }
+        }
+        else {
+            description.kind = FilterDescription::KIND_POINT;
+            ColorAdjustment copy = adjustment;
+            description.row = [copy](uchar* row, int width) { color_kernel::adjustRow(row, row, width, copy); };
+        }
+        return description;
+    }
+
+private:
+    ColorAdjustment adjustment;
+};
+
+//  ,     (Filter::describe):
+//  -          ,    ;
+//        ,   -   ,  
+//        0..255    ;
+//  -        ,   
+//        ,    .
+//          .
+//     CV_8UC3.  ,    ( ),
+//        ;   
+//       .
+//    float   ,    
+//   apply()  1  .
+class FilterChain {
+public:
+    FilterChain() {}
+    explicit FilterChain(std::vector<std::unique_ptr<Filter>> chain) {
+        for (std::unique_ptr<Filter>& filter : chain) {
+            add(std::move(filter));
+        }
+    }
+
+    void add(std::unique_ptr<Filter> filter) {
+        halo += filter->haloRadius();
+        FilterDescription description = filter->describe();
+        std::shared_ptr<Filter> shared = std::move(filter);
+        filters.push_back(shared);
+        count++;
+        if (formatChanged || description.outputChannels != 0) {
+            formatChanged = true;
+            addBarrier(shared, true);
+            return;
+        }
+        switch (description.kind) {
+        case FilterDescription::KIND_MIRROR:
+            if (host >= 0) {
+                steps[host].mirror = !steps[host].mirror;
+            }
+            else {
+                pendingMirror = !pendingMirror;
+            }
+            break;
+        case FilterDescription::KIND_LUT:
+        case FilterDescription::KIND_COLOR_MATRIX:
+        case FilterDescription::KIND_POINT:
+            addPointOp(description);
+            break;
+        case FilterDescription::KIND_NEIGHBORHOOD:
+            //     
+            addBarrier(shared, !description.mirrorSymmetric);
+            break;
+        default:
+            addBarrier(shared, true);
+            break;
+        }
+    }
+
+    //     
+    void apply(cv::Mat& image) const {
+        BufferPool pool;
+        apply(image, pool);
+    }
+
+    //        pool (. Filter::apply)
+    void apply(cv::Mat& image, BufferPool& pool) const {
+        if (image.type() != CV_8UC3) {
+            for (const std::shared_ptr<Filter>& filter : filters) {
+                ScopedTimer timer(filter->name());
+                filter->apply(image, pool);
+            }
+            return;
+        }
+        for (const Step& step : steps) {
+            if (step.filter) {
+                ScopedTimer timer(step.filter->name());
+                step.filter->apply(image, pool);
+            }
+            else if (step.ops.empty()) {
+                TRACE_SCOPE("chain.mirror");
+                cv::flip(image, image, 1);
+            }
+            else {
+                TRACE_SCOPE("chain.point_pass");
+                runPointStep(step, image);
+            }
+        }
+        if (pendingMirror) {
+            TRACE_SCOPE("chain.mirror");
+            cv::flip(image, image, 1);
+        }
+    }
+
+    int haloRadius() const { return halo; }
+    size_t size() const { return count; }
+
+    //       
+    size_t passCount() const { return steps.size() + (pendingMirror ? 1 : 0); }
+
+private:
+    struct PointOp {
+        FilterDescription::Kind kind;
+        cv::Mat lut;
+        cv::Matx34f matrix;
+        std::function<void(uchar*, int)> row;
+    };
+
+    //  -  :  ,  (ops )    
+    struct Step {
+        std::shared_ptr<Filter> filter;
+        std::vector<PointOp> ops;
+        bool mirror = false; //       
+    };
+
+    void addPointOp(const FilterDescription& description) {
+        if (host < 0) {
+            Step step;
+            step.mirror = pendingMirror;
+            pendingMirror = false;
+            steps.push_back(step);
+            host = static_cast<int>(steps.size()) - 1;
+        }
+        else if (host != static_cast<int>(steps.size()) - 1) {
+            //      ;    
+            steps.push_back(Step());
+            host = static_cast<int>(steps.size()) - 1;
+        }
+
+        PointOp op;
+        op.kind = description.kind;
+        op.lut = description.lut;
+        op.matrix = description.matrix;
+        op.row = description.row;
+        std::vector<PointOp>& ops = steps[host].ops;
+        if (ops.empty() || !fuse(ops.back(), op)) {
+            ops.push_back(op);
+        }
+    }
+
+    //   .      ,
+    //      
+    void addBarrier(const std::shared_ptr<Filter>& filter, bool blocksMirror) {
+        if (blocksMirror) {
+            if (pendingMirror) {
+                steps.push_back(Step());
+                pendingMirror = false;
+            }
+            host = -1;
+        }
+        Step step;
+        step.filter = filter;
+        steps.push_back(step);
+    }
+
+    static bool isDiagonal(const cv::Matx34f& m) {
+        return m(0, 1) == 0 && m(0, 2) == 0 && m(1, 0) == 0 && m(1, 2) == 0 && m(2, 0) == 0 && m(2, 1) == 0;
+    }
+
+    //    0..255  ,        
+    static bool staysInRange(const cv::Matx34f& m) {
+        for (int corner = 0; corner < 8; corner++) {
+            cv::Vec4f color((corner & 1) ? 255.f : 0.f, (corner & 2) ? 255.f : 0.f, (corner & 4) ? 255.f : 0.f, 1.f);
+            cv::Vec3f out = m * color;
+            for (int c = 0; c < 3; c++) {
+                if (out[c] < -0.5f || out[c] > 255.5f) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    static cv::Mat matrixToLut(const cv::Matx34f& m) {
+        cv::Mat lut(1, 256, CV_8UC3);
+        for (int v = 0; v < 256; v++) {
+            for (int c = 0; c < 3; c++) {
+                lut.ptr<uchar>()[3 * v + c] = cv::saturate_cast<uchar>(m(c, c) * v + m(c, 3));
+            }
+        }
+        return lut;
+    }
+
+    static cv::Mat composeLut(const cv::Mat& first, const cv::Mat& second) {
+        cv::Mat lut(1, 256, CV_8UC3);
+        for (int v = 0; v < 256; v++) {
+            for (int c = 0; c < 3; c++) {
+                lut.ptr<uchar>()[3 * v + c] = second.ptr<uchar>()[3 * first.ptr<uchar>()[3 * v + c] + c];
+            }
+        }
+        return lut;
+    }
+
+    //  next  last   ; false -    
+    static bool fuse(PointOp& last, const PointOp& next) {
+        if (last.kind == FilterDescription::KIND_COLOR_MATRIX && next.kind == FilterDescription::KIND_COLOR_MATRIX) {
+            if (!staysInRange(last.matrix)) {
+                return false;
+            }
+            cv::Matx44f first = cv::Matx44f::eye();
+            for (int i = 0; i < 3; i++) {
+                for (int j = 0; j < 4; j++) {
+                    first(i, j) = last.matrix(i, j);
+                }
+            }
+            last.matrix = next.matrix * first;
+            return true;
+        }
+        bool lastIsTable = last.kind == FilterDescription::KIND_LUT ||
+            (last.kind == FilterDescription::KIND_COLOR_MATRIX && isDiagonal(last.matrix));
+        bool nextIsTable = next.kind == FilterDescription::KIND_LUT ||
+            (next.kind == FilterDescription::KIND_COLOR_MATRIX && isDiagonal(next.matrix));
+        if (lastIsTable && nextIsTable) {
+            cv::Mat first = last.kind == FilterDescription::KIND_LUT ? last.lut : matrixToLut(last.matrix);
+            cv::Mat second = next.kind == FilterDescription::KIND_LUT ? next.lut : matrixToLut(next.matrix);
+            last.kind = FilterDescription::KIND_LUT;
+            last.lut = composeLut(first, second);
+            return true;
+        }
+        return false;
+    }
+
+    //    :     ,    
+    static void runPointStep(const Step& step, cv::Mat& image) {
+        const int blockRows = std::max(1, static_cast<int>(128 * 1024 / (image.cols * 3 + 1)));
+        const int blocks = (image.rows + blockRows - 1) / blockRows;
+        cv::parallel_for_(cv::Range(0, blocks), [&](const cv::Range& range) {
+            for (int b = range.start; b < range.end; b++) {
+                cv::Mat block = image.rowRange(b * blockRows, std::min(image.rows, (b + 1) * blockRows));
+                if (step.mirror) {
+                    cv::flip(block, block, 1);
+                }
+                for (const PointOp& op : step.ops) {
+                    switch (op.kind) {
+                    case FilterDescription::KIND_LUT:
+                        cv::LUT(block, op.lut, block);
+                        break;
+                    case FilterDescription::KIND_COLOR_MATRIX:
+                        cv::transform(block, block, op.matrix);
+                        break;
+                    default:
+                        for (int y = 0; y < block.rows; y++) {
+                            op.row(block.ptr<uchar>(y), block.cols);
+                        }
+                        break;
+                    }
+                }
+            }
+            });
+    }
+
+    std::vector<std::shared_ptr<Filter>> filters; //  ,    CV_8UC3
+    std::vector<Step> steps;
+    size_t count = 0;           //   
+    bool formatChanged = false; //  ,   
+    int host = -1;              //  ,     
+    bool pendingMirror = false; // ,       
+    int halo = 0;
+};
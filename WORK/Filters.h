@@ -1,62 +1,300 @@
+#pragma once
 #include <opencv2/opencv.hpp>
-#include <FL/Fl.H>
-#include <FL/Fl_Window.H>
-#include <FL/Fl_Button.H>
-#include <FL/Fl_Slider.H>
-#include <windows.h>
-#include <commdlg.h>
+#include <cmath>
+#include <functional>
 #include <memory>
 #include <string>
 #include <iostream>
 #include <stack>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "BufferPool.h"
+#include "PixelFormat.h"
+//  ,   FilterChain        
+struct FilterDescription {
+    enum Kind {
+        KIND_OPAQUE,        //   apply()
+        KIND_LUT,           //  : lut 1x256 CV_8UC3
+        KIND_COLOR_MATRIX,  //   : BGR' = matrix * (B, G, R, 1)
+        KIND_POINT,         //     row
+        KIND_MIRROR,        //   
+        KIND_NEIGHBORHOOD   //    haloRadius()
+    };
+    Kind kind = KIND_OPAQUE;
+    cv::Mat lut;
+    cv::Matx34f matrix;
+    std::function<void(uchar* row, int width)> row; //  BGR   
+    bool mirrorSymmetric = false; //    ,    
+    int outputChannels = 0; //   ,     (0 -   )
+};
+
 //     
 class Filter {
 public:
     virtual void apply(cv::Mat& image) = 0;
+    //      pool.      ,
+    //    image   ,      
+    virtual void apply(cv::Mat& image, BufferPool& /*pool*/) { apply(image); }
+    //         (   )
+    virtual int haloRadius() const { return 0; }
+    virtual FilterDescription describe() const { return FilterDescription(); }
+    //     ( )
+    virtual const char* name() const { return "filter"; }
+    //     (. createFilter  Recipe.h);  -   
+    virtual std::string spec() const { return ""; }
     virtual ~Filter() {}
 };
 
-//      
+//      .  -     
+// (- ),      
 class GrayscaleFilter : public Filter {
 public:
     void apply(cv::Mat& image) override {
-        cv::cvtColor(image, image, cv::COLOR_BGR2GRAY);
-        cv::cvtColor(image, image, cv::COLOR_GRAY2BGR);
+        if (image.channels() != 1) {
+            cv::cvtColor(image, image, conversion(image));
+        }
+    }
+    //     ;   image   
+    void apply(cv::Mat& image, BufferPool& pool) override {
+        if (image.channels() != 1) {
+            cv::Mat gray = pool.acquire(image.size(), CV_MAKETYPE(image.depth(), 1));
+            cv::cvtColor(image, gray, conversion(image));
+            image = gray;
+        }
+    }
+    const char* name() const override { return "filter.grayscale"; }
+    std::string spec() const override { return "grayscale"; }
+    FilterDescription describe() const override {
+        FilterDescription description;
+        description.kind = FilterDescription::KIND_COLOR_MATRIX;
+        for (int i = 0; i < 3; i++) {
+            description.matrix(i, 0) = 0.114f;
+            description.matrix(i, 1) = 0.587f;
+            description.matrix(i, 2) = 0.299f;
+        }
+        description.outputChannels = 1;
+        return description;
+    }
+
+private:
+    static int conversion(const cv::Mat& image) {
+        return image.channels() == 4 ? cv::COLOR_BGRA2GRAY : cv::COLOR_BGR2GRAY;
     }
 };
 
-//  
+//      radius ( 2 * radius + 1, sigma   cv::GaussianBlur).
+//      .    BOX_RADIUS
+//     box- (cv::blur   ),
+//      .   cv::GaussianBlur   17..200
+// (sigma 5.6..60.5):      2.6   255   1.5 
+//   ,    L1 -  5%.
 class BlurFilter : public Filter {
 public:
+    enum { BOX_RADIUS = 16 };
+
+    explicit BlurFilter(int radius = 7) : radius(radius) {
+        if (radius < 1) {
+            throw std::runtime_error("Blur radius must be positive");
+        }
+    }
+
     void apply(cv::Mat& image) override {
-        cv::GaussianBlur(image, image, cv::Size(15, 15), 0);
+        if (radius <= BOX_RADIUS) {
+            cv::GaussianBlur(image, image, cv::Size(2 * radius + 1, 2 * radius + 1), 0);
+            return;
+        }
+        for (int width : boxWidths()) {
+            cv::blur(image, image, cv::Size(width, width));
+        }
     }
+    //     image   
+    void apply(cv::Mat& image, BufferPool& pool) override {
+        cv::Mat target = pool.acquire(image.size(), image.type());
+        if (radius <= BOX_RADIUS) {
+            cv::GaussianBlur(image, target, cv::Size(2 * radius + 1, 2 * radius + 1), 0);
+            image = target;
+            return;
+        }
+        for (int width : boxWidths()) {
+            cv::blur(image, target, cv::Size(width, width));
+            std::swap(image, target);
+        }
+    }
+    const char* name() const override { return radius <= BOX_RADIUS ? "filter.blur" : "filter.blur_box"; }
+    std::string spec() const override { return "blur " + std::to_string(radius); }
+    int haloRadius() const override {
+        if (radius <= BOX_RADIUS) {
+            return radius;
+        }
+        int halo = 0;
+        for (int width : boxWidths()) {
+            halo += width / 2;
+        }
+        return halo;
+    }
+    FilterDescription describe() const override {
+        FilterDescription description;
+        description.kind = FilterDescription::KIND_NEIGHBORHOOD;
+        description.mirrorSymmetric = true;
+        return description;
+    }
+
+    double sigma() const { return 0.3 * (radius - 1) + 0.8; } //  OpenCV  ksize = 2 * radius + 1
+
+private:
+    //   box-    ,    (,   2)
+    std::vector<int> boxWidths() const {
+        const int passes = 3;
+        double variance = sigma() * sigma();
+        int lower = static_cast<int>(std::floor(std::sqrt(12.0 * variance / passes + 1.0)));
+        if (lower % 2 == 0) {
+            lower--;
+        }
+        int lowerCount = cvRound((12.0 * variance - passes * lower * lower - 4.0 * passes * lower - 3.0 * passes) / (-4.0 * lower - 4.0));
+        std::vector<int> widths;
+        for (int i = 0; i < passes; i++) {
+            widths.push_back(i < lowerCount ? lower : lower + 2);
+        }
+        return widths;
+    }
+
+    int radius;
 };
 
 //   
 class SharpenFilter : public Filter {
 public:
     void apply(cv::Mat& image) override {
-        cv::Mat kernel = (cv::Mat_<float>(3, 3) <<
+        cv::filter2D(image, image, -1, kernel());
+    }
+    void apply(cv::Mat& image, BufferPool& pool) override {
+        cv::Mat target = pool.acquire(image.size(), image.type());
+        cv::filter2D(image, target, -1, kernel());
+        image = target;
+    }
+    int haloRadius() const override { return 1; }
+    const char* name() const override { return "filter.sharpen"; }
+    std::string spec() const override { return "sharpen"; }
+    FilterDescription describe() const override {
+        FilterDescription description;
+        description.kind = FilterDescription::KIND_NEIGHBORHOOD;
+        description.mirrorSymmetric = true;
+        return description;
+    }
+
+private:
+    static cv::Mat kernel() {
+        return (cv::Mat_<float>(3, 3) <<
             0, -1, 0,
             -1, 5, -1,
             0, -1, 0);
-        cv::filter2D(image, image, -1, kernel);
     }
 };
 
-//   
+//   ; -  
 class InvertFilter : public Filter {
 public:
+    using Filter::apply; // apply(image, pool)   
+
     void apply(cv::Mat& image) override {
-        image = cv::Scalar::all(255) - image; //   
+        if (image.channels() != 4) {
+            cv::bitwise_not(image, image); //    ~v = max - v
+            return;
+        }
+        dispatchPixelFormat(image.type(), [&](auto format) {
+            typedef decltype(format) Format;
+            pixel_kernel::forEachRow<Format>(image, pixel_kernel::invertRow<typename Format::Value, Format::CHANNELS>);
+            });
+    }
+    const char* name() const override { return "filter.invert"; }
+    std::string spec() const override { return "invert"; }
+    FilterDescription describe() const override {
+        FilterDescription description;
+        description.kind = FilterDescription::KIND_COLOR_MATRIX;
+        description.matrix = cv::Matx34f(-1, 0, 0, 255, 0, -1, 0, 255, 0, 0, -1, 255);
+        return description;
     }
 };
 
 //   
 class MirrorFilter : public Filter {
 public:
+    using Filter::apply; // apply(image, pool)   
+
     void apply(cv::Mat& image) override {
         cv::flip(image, image, 1); //   
     }
-};
\ No newline at end of file
+    const char* name() const override { return "filter.mirror"; }
+    std::string spec() const override { return "mirror"; }
+    FilterDescription describe() const override {
+        FilterDescription description;
+        description.kind = FilterDescription::KIND_MIRROR;
+        return description;
+    }
+};
+//  :     low  high   0..255
+// (, . autoLevels  Statistics.h).    8 ,  16-
+//   ; -  
+class LevelsFilter : public Filter {
+public:
+    using Filter::apply; // apply(image, pool)   
+
+    LevelsFilter(const cv::Vec3b& low, const cv::Vec3b& high) : low(low), high(high) {}
+
+    void apply(cv::Mat& image) override {
+        if (image.type() == CV_8UC3) {
+            cv::LUT(image, table(), image);
+            return;
+        }
+        if (image.channels() == 1 && (low[0] != low[1] || low[0] != low[2] || high[0] != high[1] || high[0] != high[2])) {
+            cv::cvtColor(image, image, cv::COLOR_GRAY2BGR); //     
+        }
+        const double maxValue = image.depth() == CV_8U ? 255.0 : 65535.0;
+        float scale[3], offset[3];
+        for (int c = 0; c < 3; c++) {
+            double from = low[c] * maxValue / 255.0;
+            double to = high[c] * maxValue / 255.0;
+            scale[c] = static_cast<float>(to > from ? maxValue / (to - from) : 1.0);
+            offset[c] = static_cast<float>(to > from ? -from * scale[c] : 0.0);
+        }
+        dispatchPixelFormat(image.type(), [&](auto format) {
+            typedef decltype(format) Format;
+            pixel_kernel::forEachRow<Format>(image, [&](typename Format::Value* row, int width) {
+                pixel_kernel::levelsRow<typename Format::Value, Format::CHANNELS>(row, width, scale, offset);
+                });
+            });
+    }
+    const char* name() const override { return "filter.levels"; }
+    std::string spec() const override {
+        std::string result = "levels";
+        for (int c = 0; c < 3; c++) {
+            result += " " + std::to_string(low[c]);
+        }
+        for (int c = 0; c < 3; c++) {
+            result += " " + std::to_string(high[c]);
+        }
+        return result;
+    }
+    FilterDescription describe() const override {
+        FilterDescription description;
+        description.kind = FilterDescription::KIND_LUT;
+        description.lut = table();
+        return description;
+    }
+
+private:
+    cv::Mat table() const {
+        cv::Mat lut(1, 256, CV_8UC3);
+        for (int c = 0; c < 3; c++) {
+            double scale = high[c] > low[c] ? 255.0 / (high[c] - low[c]) : 1.0; //   -  
+            double offset = high[c] > low[c] ? -low[c] * scale : 0.0;
+            for (int v = 0; v < 256; v++) {
+                lut.ptr<uchar>()[3 * v + c] = cv::saturate_cast<uchar>(v * scale + offset);
+            }
+        }
+        return lut;
+    }
+
+    cv::Vec3b low, high;
+};
@@ -1,8 +1,11 @@
 #include <opencv2/opencv.hpp>
 #include <FL/Fl.H>
 #include <FL/Fl_Window.H>
+#include <FL/Fl_Double_Window.H>
 #include <FL/Fl_Button.H>
+#include <FL/Fl_Check_Button.H>
 #include <FL/Fl_Slider.H>
+#include <FL/Fl_Value_Slider.H>
 #include <windows.h>
 #include <commdlg.h>
 #include <memory>
@@ -24,6 +27,15 @@ public:
         Fl_Button* undoButton = new Fl_Button(x + 2 * (w + 10), y, w, h, "Undo");
         undoButton->callback(undoCallback, editor);
 
+        Fl_Button* openSessionButton = new Fl_Button(x + 3 * (w + 10), y, w, h, "Open Session");
+        openSessionButton->callback(openSessionCallback, editor);
+
+        Fl_Button* saveSessionButton = new Fl_Button(x + 4 * (w + 10), y, w, h, "Save Session");
+        saveSessionButton->callback(saveSessionCallback, editor);
+
+        Fl_Button* autoLevelsButton = new Fl_Button(x + 5 * (w + 10), y, w, h, "Auto Levels");
+        autoLevelsButton->callback(autoLevelsCallback, editor);
+
         Fl_Button* grayscaleButton = new Fl_Button(x, y + h + 10, w, h, "Grayscale");
         grayscaleButton->callback(applyGrayscaleCallback, editor);
 
@@ -51,6 +63,39 @@ public:
 
         Fl_Button* paletteButton = new Fl_Button(x, parent->h() - h - 10, w, h, "Extract Palette");
         paletteButton->callback(extractPaletteCallback, editor);
+
+        Fl_Value_Slider* paletteSizeSlider = new Fl_Value_Slider(x + w + 10, parent->h() - h - 10, 2 * w, h, "Colors");
+        paletteSizeSlider->type(FL_HORIZONTAL);
+        paletteSizeSlider->align(FL_ALIGN_RIGHT);
+        paletteSizeSlider->bounds(1, 16);
+        paletteSizeSlider->step(1);
+        paletteSizeSlider->value(editor->getPaletteSize());
+        paletteSizeSlider->callback([](Fl_Widget* widget, void* data) {
+            ImageEditor* editor = static_cast<ImageEditor*>(data);
+            editor->setPaletteSize(static_cast<int>(static_cast<Fl_Value_Slider*>(widget)->value()));
+            }, editor);
+
+        Fl_Value_Slider* qualitySlider = new Fl_Value_Slider(x + 3 * (w + 10) + 60, parent->h() - h - 10, w, h, "Quality");
+        qualitySlider->type(FL_HORIZONTAL);
+        qualitySlider->align(FL_ALIGN_RIGHT);
+        qualitySlider->bounds(10, 100);
+        qualitySlider->step(1);
+        qualitySlider->value(editor->getExportSettings().jpegQuality);
+        qualitySlider->callback([](Fl_Widget* widget, void* data) {
+            ImageEditor* editor = static_cast<ImageEditor*>(data);
+            ExportSettings settings = editor->getExportSettings();
+            settings.jpegQuality = static_cast<int>(static_cast<Fl_Value_Slider*>(widget)->value());
+            editor->setExportSettings(settings);
+            }, editor);
+
+        Fl_Check_Button* progressiveButton = new Fl_Check_Button(x + 5 * (w + 10), parent->h() - h - 10, w, h, "Progressive");
+        progressiveButton->value(editor->getExportSettings().progressive ? 1 : 0);
+        progressiveButton->callback([](Fl_Widget* widget, void* data) {
+            ImageEditor* editor = static_cast<ImageEditor*>(data);
+            ExportSettings settings = editor->getExportSettings();
+            settings.progressive = static_cast<Fl_Check_Button*>(widget)->value() != 0;
+            editor->setExportSettings(settings);
+            }, editor);
     }
 };
 
@@ -127,18 +172,35 @@ public:
             int blue = static_cast<Fl_Slider*>(widget)->value();
             editor->setRGB(red, green, blue);
             }, editor);
+
+        //    ,  
+        editor->setParamsListener([=](const AdjustmentParams& params) {
+            brightnessSlider->value(params.brightness);
+            saturationSlider->value(params.saturation);
+            scaleSlider->value(params.scaleFactor);
+            redSlider->value(params.r);
+            greenSlider->value(params.g);
+            blueSlider->value(params.b);
+            });
     }
 };
 
 class MainWindow {
 public:
     MainWindow() {
-        Fl_Window* window = new Fl_Window(800, 400, "Image Editor");
+        Fl_Double_Window* window = new Fl_Double_Window(1400, 720, "Image Editor");
         ImageEditor editor;
 
         ButtonPanel buttonPanel(window, 10, 10, 120, 30, &editor);
         SliderPanel sliderPanel(window, 10, 90, 760, 20, &editor);
 
+        ImageView* preview = new ImageView(800, 10, 590, 700);
+        editor.setPreview(preview);
+        window->resizable(preview);
+
+        HistogramView* histogram = new HistogramView(10, 400, 760, 230);
+        editor.setHistogramView(histogram);
+
         window->end();
         window->show();
         Fl::run();
@@ -0,0 +1,75 @@
+#pragma once
+#include <FL/Fl.H>
+#include <FL/Fl_Widget.H>
+#include <FL/fl_draw.H>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include "Statistics.h"
+#include "Trace.h"
+
+//   :  - ,  R, G, B - ,
+//  ,    
+class HistogramView : public Fl_Widget {
+public:
+    HistogramView(int x, int y, int w, int h) : Fl_Widget(x, y, w, h) {}
+
+    //    ( )
+    void setStatistics(const ImageStatistics& value) {
+        statistics = value;
+        redraw();
+    }
+
+protected:
+    void draw() override {
+        TRACE_SCOPE("display.histogram");
+        fl_push_clip(x(), y(), w(), h());
+        fl_color(FL_BLACK);
+        fl_rectf(x(), y(), w(), h());
+        if (statistics.pixels > 0) {
+            const int textHeight = 18;
+            const int plotHeight = h() - textHeight;
+            const int bottom = y() + plotHeight;
+            //        0  255,  
+            //          
+            uint64_t peak = 1;
+            for (int c = 0; c < ImageStatistics::CHANNEL_COUNT; c++) {
+                for (int v = 1; v < 255; v++) {
+                    peak = std::max(peak, statistics.histogram[c][v]);
+                }
+            }
+            auto top = [&](int channel, int v) {
+                uint64_t count = std::min(statistics.histogram[channel][v], peak);
+                return bottom - static_cast<int>(count * plotHeight / peak);
+            };
+            auto column = [&](int v) { return x() + v * w() / 256; };
+
+            fl_color(FL_DARK3);
+            for (int v = 0; v < 256; v++) {
+                int height = bottom - top(ImageStatistics::CHANNEL_LUMA, v);
+                fl_rectf(column(v), bottom - height, std::max(1, column(v + 1) - column(v)), height);
+            }
+            const Fl_Color colors[3] = { FL_BLUE, FL_GREEN, FL_RED };
+            for (int c = 0; c < 3; c++) {
+                fl_color(colors[c]);
+                fl_begin_line();
+                for (int v = 0; v < 256; v++) {
+                    fl_vertex(column(v), top(c, v));
+                }
+                fl_end_line();
+            }
+
+            char text[128];
+            std::snprintf(text, sizeof(text), "Luminance: min %d   max %d   mean %.1f",
+                statistics.minimum(ImageStatistics::CHANNEL_LUMA), statistics.maximum(ImageStatistics::CHANNEL_LUMA),
+                statistics.mean(ImageStatistics::CHANNEL_LUMA));
+            fl_color(FL_WHITE);
+            fl_font(FL_HELVETICA, 12);
+            fl_draw(text, x() + 4, y() + h() - 5);
+        }
+        fl_pop_clip();
+    }
+
+private:
+    ImageStatistics statistics;
+};
@@ -0,0 +1,328 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <map>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+#include "Pipeline.h"
+
+//       .
+//    ,      (. TileStore);
+//          .
+class TileDelta {
+public:
+    explicit TileDelta(std::vector<uchar>&& encoded) : data(std::move(encoded)), size(data.size()) {}
+
+    ~TileDelta() {
+        if (!spillPath.empty()) {
+            std::remove(spillPath.c_str());
+        }
+    }
+
+    TileDelta(const TileDelta&) = delete;
+    TileDelta& operator=(const TileDelta&) = delete;
+
+    size_t bytes() const { return size; }
+    bool isSpilled() const { return !spillPath.empty(); }
+
+    //     (   )
+    bool sameData(const std::vector<uchar>& encoded) const {
+        return !isSpilled() && data == encoded;
+    }
+
+    //    ;    
+    size_t spill() {
+        if (isSpilled()) {
+            return 0;
+        }
+        std::string path = cv::tempfile(".undo");
+        std::ofstream file(path, std::ios::binary);
+        file.write(reinterpret_cast<const char*>(data.data()), data.size());
+        if (!file) {
+            throw std::runtime_error("Failed to spill undo history to disk");
+        }
+        spillPath = path;
+        std::vector<uchar>().swap(data);
+        return size;
+    }
+
+    //   
+    cv::Mat decode() const {
+        if (!isSpilled()) {
+            return cv::imdecode(data, cv::IMREAD_UNCHANGED);
+        }
+        std::ifstream file(spillPath, std::ios::binary);
+        std::vector<uchar> buffer((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+        return cv::imdecode(buffer, cv::IMREAD_UNCHANGED);
+    }
+
+private:
+    std::vector<uchar> data;
+    size_t size;
+    std::string spillPath;
+};
+
+//  ,    .    :  Invert
+//          XOR,   -   ,    .
+class TileStore {
+public:
+    //    encoded:      ; added -    
+    std::shared_ptr<TileDelta> intern(std::vector<uchar>&& encoded, size_t& added) {
+        const size_t key = hash(encoded);
+        auto range = tiles.equal_range(key);
+        for (auto it = range.first; it != range.second; ++it) {
+            std::shared_ptr<TileDelta> tile = it->second.lock();
+            if (tile && tile->sameData(encoded)) {
+                return tile;
+            }
+        }
+        std::shared_ptr<TileDelta> tile = std::make_shared<TileDelta>(std::move(encoded));
+        tiles.emplace(key, tile);
+        added += tile->bytes();
+        return tile;
+    }
+
+    //    ,       
+    void prune() {
+        for (auto it = tiles.begin(); it != tiles.end();) {
+            if (it->second.expired()) {
+                it = tiles.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+
+    void clear() { tiles.clear(); }
+
+private:
+    // FNV-1a   
+    static size_t hash(const std::vector<uchar>& data) {
+        uint64_t value = 14695981039346656037ull;
+        for (uchar byte : data) {
+            value = (value ^ byte) * 1099511628211ull;
+        }
+        return static_cast<size_t>(value);
+    }
+
+    std::unordered_multimap<size_t, std::weak_ptr<TileDelta>> tiles;
+};
+
+//    .
+//      ,  XOR        ,
+//  -   .
+class PixelDelta {
+public:
+    // added -     store (    )
+    static std::shared_ptr<PixelDelta> compute(const cv::Mat& before, const cv::Mat& after, TileStore& store, size_t& added,
+        int tileSize = 256) {
+        std::shared_ptr<PixelDelta> delta = std::make_shared<PixelDelta>();
+        delta->fullFrame = before.size() != after.size() || before.type() != after.type();
+        if (delta->fullFrame) {
+            delta->tiles.push_back(encodeTile(cv::Rect(0, 0, before.cols, before.rows), before, store, added));
+            return delta;
+        }
+
+        for (int y = 0; y < before.rows; y += tileSize) {
+            for (int x = 0; x < before.cols; x += tileSize) {
+                cv::Rect rect(x, y, std::min(tileSize, before.cols - x), std::min(tileSize, before.rows - y));
+                cv::Mat difference;
+                cv::bitwise_xor(before(rect), after(rect), difference);
+                if (cv::countNonZero(difference.reshape(1)) > 0) {
+                    delta->tiles.push_back(encodeTile(rect, difference, store, added)); //    
+                }
+            }
+        }
+        return delta;
+    }
+
+    //     ""   "".
+    //   image    ,      ,
+    //   :       (,  )
+    void revert(cv::Mat& image) const {
+        if (fullFrame) {
+            image = tiles.front().data->decode();
+            return;
+        }
+        cv::Mat restored = image.u && image.u->refcount == 1 ? image : image.clone();
+        for (const Tile& tile : tiles) {
+            cv::Mat region = restored(tile.rect);
+            cv::bitwise_xor(region, tile.data->decode(), region);
+        }
+        image = restored;
+    }
+
+    //    "" ( ,   )
+    std::vector<cv::Rect> changedRects() const {
+        std::vector<cv::Rect> rects;
+        for (const Tile& tile : tiles) {
+            rects.push_back(tile.rect);
+        }
+        return rects;
+    }
+
+    // ,      : ,     
+    size_t exclusiveBytes() const {
+        std::map<const TileDelta*, long> uses;
+        for (const Tile& tile : tiles) {
+            uses[tile.data.get()]++;
+        }
+        size_t total = 0;
+        for (const Tile& tile : tiles) {
+            auto use = uses.find(tile.data.get());
+            if (use != uses.end() && tile.data.use_count() == use->second && !tile.data->isSpilled()) {
+                total += tile.data->bytes();
+            }
+            if (use != uses.end()) {
+                uses.erase(use); //     
+            }
+        }
+        return total;
+    }
+
+    //   ;    
+    size_t spill() {
+        size_t freed = 0;
+        for (const Tile& tile : tiles) {
+            freed += tile.data->spill();
+        }
+        return freed;
+    }
+
+private:
+    struct Tile {
+        cv::Rect rect;
+        std::shared_ptr<TileDelta> data;
+    };
+
+    static Tile encodeTile(const cv::Rect& rect, const cv::Mat& pixels, TileStore& store, size_t& added) {
+        std::vector<uchar> encoded;
+        //    : XOR-     
+        if (!cv::imencode(".png", pixels, encoded, { cv::IMWRITE_PNG_COMPRESSION, 1 })) {
+            throw std::runtime_error("Failed to compress undo tile");
+        }
+        Tile tile;
+        tile.rect = rect;
+        tile.data = store.intern(std::move(encoded), added);
+        return tile;
+    }
+
+    bool fullFrame = false;
+    std::vector<Tile> tiles;
+};
+
+//    .
+//      ,   -    ,
+//     .       ,  
+//   .
+class UndoHistory {
+public:
+    enum Param { PARAM_BRIGHTNESS, PARAM_SATURATION, PARAM_SCALE, PARAM_RED, PARAM_GREEN, PARAM_BLUE, PARAM_OVERLAY };
+
+    explicit UndoHistory(size_t memoryBudgetBytes = 256u << 20) : memoryBudget(memoryBudgetBytes) {}
+
+    void setMemoryBudget(size_t bytes) {
+        memoryBudget = bytes;
+        enforceBudget();
+    }
+
+    void clear() {
+        entries.clear();
+        store.clear();
+        bytesInMemory = 0;
+        merging = false;
+    }
+
+    //   ( ):      
+    void breakMerge() {
+        merging = false;
+    }
+
+    bool empty() const { return entries.empty(); }
+    size_t memoryUsage() const { return bytesInMemory; }
+
+    //    .      
+    // (  ,  breakMerge)    ;
+    //    -  .
+    void recordParams(Param param, const AdjustmentParams& before,
+        const std::vector<OverlayLayer>& overlaysBefore = std::vector<OverlayLayer>()) {
+        if (merging && param != PARAM_OVERLAY && !entries.empty() && !entries.back().delta && entries.back().param == param) {
+            return;
+        }
+        merging = true;
+        Entry entry;
+        entry.param = param;
+        entry.params = before;
+        entry.overlays = overlaysBefore; //    ,  
+        entries.push_back(entry);
+    }
+
+    //   ,   ;   
+    std::vector<cv::Rect> recordPixels(const cv::Mat& before, const cv::Mat& after) {
+        TRACE_SCOPE("undo.record");
+        store.prune(); //   
+        Entry entry;
+        size_t added = 0;
+        entry.delta = PixelDelta::compute(before, after, store, added);
+        bytesInMemory += added;
+        merging = false;
+        entries.push_back(entry);
+        enforceBudget();
+        return entry.delta->changedRects();
+    }
+
+    //   .  true,    image,
+    //   params  overlays. changed  ,    
+    bool undo(cv::Mat& image, AdjustmentParams& params, std::vector<OverlayLayer>& overlays,
+        std::vector<cv::Rect>* changed = nullptr) {
+        Entry entry = entries.back();
+        entries.pop_back();
+        merging = false;
+        if (entry.delta) {
+            bytesInMemory -= entry.delta->exclusiveBytes();
+            entry.delta->revert(image);
+            if (changed) {
+                *changed = entry.delta->changedRects();
+            }
+            return true;
+        }
+        params = entry.params;
+        if (entry.param == PARAM_OVERLAY) {
+            overlays = entry.overlays;
+        }
+        return false;
+    }
+
+private:
+    struct Entry {
+        Param param = PARAM_BRIGHTNESS;
+        AdjustmentParams params;
+        std::vector<OverlayLayer> overlays;
+        std::shared_ptr<PixelDelta> delta; //    
+    };
+
+    //     ,     
+    void enforceBudget() {
+        for (Entry& entry : entries) {
+            if (bytesInMemory <= memoryBudget) {
+                break;
+            }
+            if (entry.delta) {
+                bytesInMemory -= entry.delta->spill(); //     
+            }
+        }
+    }
+
+    std::deque<Entry> entries;
+    TileStore store;
+    size_t memoryBudget;
+    size_t bytesInMemory = 0;
+    bool merging = false; //  ,    
+};
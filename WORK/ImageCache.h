@@ -0,0 +1,191 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <exception>
+#include <filesystem>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include "ImageLoader.h"
+#include "Overlay.h"
+#include "ProxyPyramid.h"
+#include "Trace.h"
+
+//            (LRU).
+//   ,   (BGRA)    .
+//  ,        .   
+//      ,    ,   .
+//       :     .
+//   ,     , 
+//         .
+class ImageCache {
+public:
+    struct Stats {
+        size_t hits = 0;
+        size_t misses = 0;
+        size_t entries = 0;
+        size_t bytes = 0;
+    };
+
+    explicit ImageCache(size_t budgetBytes) : budget(budgetBytes) {}
+
+    ImageCache(const ImageCache&) = delete;
+    ImageCache& operator=(const ImageCache&) = delete;
+
+    //     (. decodeImageFile)
+    std::shared_ptr<const cv::Mat> image(const std::string& path) {
+        return lookup<cv::Mat>("image:" + path, path, [&] {
+            TRACE_SCOPE("cache.decode");
+            cv::Mat decoded = decodeImageFile(path);
+            if (decoded.empty()) {
+                throw std::runtime_error("Failed to decode " + path);
+            }
+            return std::make_shared<const cv::Mat>(decoded);
+            }, [](const cv::Mat& value) { return value.total() * value.elemSize(); });
+    }
+
+    //    BGRA (. loadOverlayImage)
+    std::shared_ptr<const cv::Mat> overlay(const std::string& path) {
+        return lookup<cv::Mat>("overlay:" + path, path, [&] {
+            TRACE_SCOPE("cache.decode_overlay");
+            cv::Mat decoded = loadOverlayImage(path);
+            if (decoded.empty()) {
+                throw std::runtime_error("Failed to load overlay image: " + path);
+            }
+            return std::make_shared<const cv::Mat>(decoded);
+            }, [](const cv::Mat& value) { return value.total() * value.elemSize(); });
+    }
+
+    //   ;  0 -   ,   image(path)
+    std::shared_ptr<const ProxyPyramid> pyramid(const std::string& path) {
+        return lookup<ProxyPyramid>("pyramid:" + path, path, [&] {
+            std::shared_ptr<const cv::Mat> source = image(path);
+            TRACE_SCOPE("cache.pyramid");
+            auto pyramid = std::make_shared<ProxyPyramid>();
+            pyramid->build(*source);
+            return std::shared_ptr<const ProxyPyramid>(pyramid);
+            }, [](const ProxyPyramid& value) {
+                size_t bytes = 0;
+                //  0  :      ,
+                //      .    ,   
+                for (int i = 0; i < value.size(); i++) {
+                    bytes += value.level(i).total() * value.level(i).elemSize();
+                }
+                return bytes;
+            });
+    }
+
+    Stats stats() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        Stats result = counters;
+        result.entries = entries.size();
+        result.bytes = used;
+        return result;
+    }
+
+private:
+    //  :     
+    struct Stamp {
+        uintmax_t size = 0;
+        std::filesystem::file_time_type modified;
+        bool operator==(const Stamp& other) const { return size == other.size && modified == other.modified; }
+    };
+
+    struct Entry {
+        std::string key;
+        Stamp stamp;
+        std::shared_ptr<const void> value;
+        size_t bytes = 0;
+    };
+
+    static Stamp stampOf(const std::string& path) {
+        Stamp stamp;
+        std::error_code error;
+        stamp.size = std::filesystem::file_size(path, error);
+        stamp.modified = std::filesystem::last_write_time(path, error);
+        if (error) {
+            throw std::runtime_error("Failed to open " + path);
+        }
+        return stamp;
+    }
+
+    template<typename T>
+    std::shared_ptr<const T> lookup(const std::string& key, const std::string& path,
+        const std::function<std::shared_ptr<const T>()>& load, const std::function<size_t(const T&)>& measure) {
+        const Stamp stamp = stampOf(path);
+        std::shared_future<std::shared_ptr<const void>> pending;
+        std::promise<std::shared_ptr<const void>> promise;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto found = index.find(key);
+            if (found != index.end() && found->second->stamp == stamp) {
+                entries.splice(entries.begin(), entries, found->second); //   
+                counters.hits++;
+                return std::static_pointer_cast<const T>(found->second->value);
+            }
+            auto loading = inProgress.find(key);
+            if (loading != inProgress.end()) {
+                pending = loading->second;
+            }
+            else {
+                counters.misses++;
+                inProgress[key] = promise.get_future().share();
+            }
+        }
+        if (pending.valid()) {
+            return std::static_pointer_cast<const T>(pending.get()); //     
+        }
+
+        std::shared_ptr<const T> value;
+        try {
+            value = load();
+        }
+        catch (...) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                inProgress.erase(key);
+            }
+            promise.set_exception(std::current_exception());
+            throw;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            inProgress.erase(key);
+            auto found = index.find(key);
+            if (found != index.end()) {
+                used -= found->second->bytes; //     
+                entries.erase(found->second);
+                index.erase(found);
+            }
+            Entry entry;
+            entry.key = key;
+            entry.stamp = stamp;
+            entry.value = value;
+            entry.bytes = measure(*value);
+            used += entry.bytes;
+            entries.push_front(entry);
+            index[key] = entries.begin();
+            //    ;     ,     
+            while (used > budget && entries.size() > 1) {
+                used -= entries.back().bytes;
+                index.erase(entries.back().key);
+                entries.pop_back();
+            }
+        }
+        promise.set_value(value);
+        return value;
+    }
+
+    const size_t budget;
+    mutable std::mutex mutex;
+    std::list<Entry> entries; //       
+    std::unordered_map<std::string, std::list<Entry>::iterator> index;
+    std::unordered_map<std::string, std::shared_future<std::shared_ptr<const void>>> inProgress;
+    size_t used = 0;
+    Stats counters;
+};
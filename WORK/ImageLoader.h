@@ -0,0 +1,300 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <climits>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "PixelFormat.h"
+#include "Trace.h"
+
+// ,      .
+//        ,   .
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+        if (file == INVALID_HANDLE_VALUE) {
+            throw std::runtime_error("Failed to open " + path);
+        }
+        LARGE_INTEGER fileSize;
+        GetFileSizeEx(file, &fileSize);
+        length = static_cast<size_t>(fileSize.QuadPart);
+        if (length > 0) {
+            mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+            bytes = mapping ? static_cast<const uchar*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+        }
+#else
+        descriptor = ::open(path.c_str(), O_RDONLY);
+        if (descriptor < 0) {
+            throw std::runtime_error("Failed to open " + path);
+        }
+        struct stat info;
+        fstat(descriptor, &info);
+        length = static_cast<size_t>(info.st_size);
+        if (length > 0) {
+            void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, descriptor, 0);
+            bytes = address == MAP_FAILED ? nullptr : static_cast<const uchar*>(address);
+            if (bytes) {
+                madvise(address, length, MADV_SEQUENTIAL);
+            }
+        }
+#endif
+        if (!bytes) {
+            close();
+            throw std::runtime_error("Failed to map " + path);
+        }
+    }
+
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uchar* data() const { return bytes; }
+    size_t size() const { return length; }
+
+    //     cv::Mat   (,   MappedFile).
+    //  cv::imdecode;   cv::Mat  INT_MAX 
+    cv::Mat view() const {
+        if (length > static_cast<size_t>(INT_MAX)) {
+            throw std::runtime_error("File is too large to decode (over 2 GB)");
+        }
+        return cv::Mat(1, static_cast<int>(length), CV_8U, const_cast<uchar*>(bytes));
+    }
+
+    // JPEG     ( DCT)
+    bool isJpeg() const {
+        return length > 3 && bytes[0] == 0xFF && bytes[1] == 0xD8 && bytes[2] == 0xFF;
+    }
+
+private:
+    void close() {
+#ifdef _WIN32
+        if (bytes) UnmapViewOfFile(bytes);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+        mapping = NULL;
+        file = INVALID_HANDLE_VALUE;
+#else
+        if (bytes) munmap(const_cast<uchar*>(bytes), length);
+        if (descriptor >= 0) ::close(descriptor);
+        descriptor = -1;
+#endif
+        bytes = nullptr;
+    }
+
+#ifdef _WIN32
+    HANDLE file = INVALID_HANDLE_VALUE;
+    HANDLE mapping = NULL;
+#else
+    int descriptor = -1;
+#endif
+    const uchar* bytes = nullptr;
+    size_t length = 0;
+};
+
+//      ; flags -   cv::imread.
+//        (, BGRA, 16 , . PixelFormat.h).
+//   -    .
+inline cv::Mat decodeImageFile(const std::string& path, int flags = cv::IMREAD_UNCHANGED) {
+    TRACE_SCOPE("image.decode");
+    MappedFile file(path);
+    if (flags != cv::IMREAD_UNCHANGED) {
+        return cv::imdecode(file.view(), flags);
+    }
+    //  JPEG   EXIF,  IMREAD_UNCHANGED 
+    int natural = file.isJpeg() ? cv::IMREAD_ANYCOLOR | cv::IMREAD_ANYDEPTH : cv::IMREAD_UNCHANGED;
+    return normalizeImageFormat(cv::imdecode(file.view(), natural));
+}
+
+//     :      
+// ( JPEG     DCT     ),   
+//  .     takeFull()   .
+//       :      ,
+//    .
+class ImageLoader {
+public:
+    //    ,       
+    typedef std::function<void()> LoadedCallback;
+
+    explicit ImageLoader(LoadedCallback callback) : state(std::make_shared<State>()) {
+        state->onLoaded = callback;
+        thread = std::thread(&ImageLoader::run, state);
+    }
+
+    //    ,    ,  :
+    //         ,   callback
+    ~ImageLoader() {
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->stopping = true;
+            state->request = nullptr;
+        }
+        state->wake.notify_one();
+        thread.detach();
+    }
+
+    ImageLoader(const ImageLoader&) = delete;
+    ImageLoader& operator=(const ImageLoader&) = delete;
+
+    //         .
+    // reduction - 2, 4  8; fullSize -     (  ).
+    //    ,    
+    //    fullSize,   ,   .
+    cv::Mat open(const std::string& path, int reduction, cv::Size& fullSize) {
+        cancel();
+        cv::Mat preview;
+        {
+            MappedFile file(path);
+            if (!file.isJpeg()) {
+                TRACE_SCOPE("image.decode");
+                preview = normalizeImageFormat(cv::imdecode(file.view(), cv::IMREAD_UNCHANGED));
+                fullSize = preview.size();
+                return preview;
+            }
+            TRACE_SCOPE("image.decode_reduced");
+            preview = cv::imdecode(file.view(), reducedFlag(reduction));
+        }
+        if (preview.empty()) {
+            return preview;
+        }
+        fullSize = cv::Size(preview.cols * reduction, preview.rows * reduction);
+        loadInBackground([path] {
+            cv::Mat full = decodeImageFile(path);
+            if (full.empty()) {
+                throw std::runtime_error("Failed to decode " + path);
+            }
+            return full;
+            });
+        return preview;
+    }
+
+    //       (,   );
+    //   takeFull(),   open().   load   
+    void loadInBackground(std::function<cv::Mat()> load) {
+        {
+            std::lock_guard<std::mutex> lock(state->mutex);
+            state->reset();
+            state->request = load;
+            state->requestGeneration = state->currentGeneration;
+            state->decoding = true;
+        }
+        state->wake.notify_one();
+    }
+
+    //       (  )
+    void cancel() {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->reset();
+    }
+
+    //     ( ).
+    // false -   ;   image ,    errorMessage.
+    bool takeFull(cv::Mat& image, std::string& errorMessage) {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        if (!state->hasResult) {
+            return false;
+        }
+        image = state->result;
+        errorMessage = state->error;
+        state->result.release();
+        state->hasResult = false;
+        return true;
+    }
+
+    //          
+    bool pending() const {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        return state->decoding || state->hasResult;
+    }
+
+private:
+    // ,      
+    struct State {
+        LoadedCallback onLoaded;
+        std::mutex mutex;
+        std::condition_variable wake;
+        std::function<cv::Mat()> request; //    ;  -  
+        int requestGeneration = 0;
+        bool stopping = false;
+        int currentGeneration = 0;
+        bool hasResult = false;
+        bool decoding = false;
+        cv::Mat result;
+        std::string error;
+
+        //  :       
+        void reset() {
+            ++currentGeneration;
+            request = nullptr;
+            hasResult = false;
+            decoding = false;
+            result.release();
+            error.clear();
+        }
+    };
+
+    static void run(std::shared_ptr<State> state) {
+        std::unique_lock<std::mutex> lock(state->mutex);
+        while (true) {
+            state->wake.wait(lock, [&] { return state->stopping || state->request; });
+            if (state->stopping) {
+                return;
+            }
+            std::function<cv::Mat()> load = state->request;
+            int generation = state->requestGeneration;
+            state->request = nullptr;
+            lock.unlock();
+
+            cv::Mat full;
+            std::string message;
+            try {
+                full = load();
+            }
+            catch (const std::exception& e) {
+                message = e.what();
+            }
+
+            lock.lock();
+            if (state->stopping) {
+                return;
+            }
+            if (generation != state->currentGeneration) {
+                continue; //    
+            }
+            state->result = full;
+            state->error = message;
+            state->hasResult = true;
+            state->decoding = false;
+            state->onLoaded(); //  :     
+        }
+    }
+
+    static int reducedFlag(int reduction) {
+        switch (reduction) {
+        case 2: return cv::IMREAD_REDUCED_COLOR_2;
+        case 4: return cv::IMREAD_REDUCED_COLOR_4;
+        default: return cv::IMREAD_REDUCED_COLOR_8;
+        }
+    }
+
+    std::shared_ptr<State> state;
+    std::thread thread;
+};
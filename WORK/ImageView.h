@@ -0,0 +1,89 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <FL/Fl.H>
+#include <FL/Fl_Widget.H>
+#include <FL/fl_draw.H>
+#include <algorithm>
+#include <functional>
+#include "Trace.h"
+
+//     .
+//  RGB           .
+//    :     ,     
+// (. RenderPipeline::runStage),        .
+class ImageView : public Fl_Widget {
+public:
+    //      (   )
+    typedef std::function<void(int width, int height)> ResizeCallback;
+    //     ; dx, dy -     
+    typedef std::function<void(int dx, int dy)> PanCallback;
+
+    ImageView(int x, int y, int w, int h) : Fl_Widget(x, y, w, h) {}
+
+    //   CV_8UC3   RGB ( )
+    void setFrame(const cv::Mat& rgb) {
+        CV_Assert(rgb.empty() || rgb.type() == CV_8UC3);
+        frame = rgb;
+        redraw();
+    }
+
+    void setResizeCallback(ResizeCallback callback) {
+        onResize = callback;
+    }
+
+    void setPanCallback(PanCallback callback) {
+        onPan = callback;
+    }
+
+    int handle(int event) override {
+        switch (event) {
+        case FL_PUSH:
+            dragPosition = cv::Point(Fl::event_x(), Fl::event_y());
+            return 1;
+        case FL_DRAG: {
+            cv::Point position(Fl::event_x(), Fl::event_y());
+            if (onPan && position != dragPosition) {
+                onPan(position.x - dragPosition.x, position.y - dragPosition.y);
+            }
+            dragPosition = position;
+            return 1;
+        }
+        case FL_RELEASE:
+            return 1;
+        default:
+            return Fl_Widget::handle(event);
+        }
+    }
+
+    void resize(int x, int y, int w, int h) override {
+        Fl_Widget::resize(x, y, w, h);
+        if (onResize) {
+            onResize(w, h);
+        }
+    }
+
+protected:
+    void draw() override {
+        TRACE_SCOPE("display.draw");
+        fl_push_clip(x(), y(), w(), h());
+        fl_color(FL_DARK3);
+        fl_rectf(x(), y(), w(), h());
+        if (!frame.empty()) {
+            //   ;         ,
+            //       ( ),   
+            int width = std::min(frame.cols, w());
+            int height = std::min(frame.rows, h());
+            int left = (frame.cols - width) / 2;
+            int top = (frame.rows - height) / 2;
+            fl_draw_image(frame.ptr<uchar>(top) + 3 * left, x() + (w() - width) / 2, y() + (h() - height) / 2,
+                width, height, 3, static_cast<int>(frame.step));
+        }
+        fl_pop_clip();
+    }
+
+private:
+    cv::Mat frame;
+    ResizeCallback onResize;
+    PanCallback onPan;
+    cv::Point dragPosition;
+};
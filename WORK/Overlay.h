@@ -0,0 +1,272 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "Trace.h"
+
+//  :   -,   
+struct OverlayLayer {
+    cv::Mat image;   // CV_8UC4, BGRA (. loadOverlayImage)
+    cv::Rect2d placement = cv::Rect2d(0, 0, 1, 1); //      
+    double opacity = 1.0;
+    std::string source; //   (  )
+};
+
+//    (   )
+inline bool sameLayers(const std::vector<OverlayLayer>& a, const std::vector<OverlayLayer>& b) {
+    if (a.size() != b.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < a.size(); i++) {
+        if (a[i].image.data != b[i].image.data || a[i].placement != b[i].placement || a[i].opacity != b[i].opacity) {
+            return false;
+        }
+    }
+    return true;
+}
+
+//       ;     BGRA 8 .
+//   -   .
+inline cv::Mat loadOverlayImage(const std::string& path) {
+    cv::Mat image = cv::imread(path, cv::IMREAD_UNCHANGED);
+    if (image.empty()) {
+        return image;
+    }
+    if (image.depth() == CV_16U) {
+        image.convertTo(image, CV_8U, 1.0 / 257);
+    }
+    else if (image.depth() != CV_8U) {
+        image.convertTo(image, CV_8U, image.depth() == CV_32F || image.depth() == CV_64F ? 255.0 : 1.0);
+    }
+    switch (image.channels()) {
+    case 1:
+        cv::cvtColor(image, image, cv::COLOR_GRAY2BGRA);
+        break;
+    case 3:
+        cv::cvtColor(image, image, cv::COLOR_BGR2BGRA);
+        break;
+    default:
+        break;
+    }
+    return image;
+}
+
+namespace overlay_kernel {
+    // x / 255    x <= 255 * 255
+    inline int div255(int x) {
+        x += 128;
+        return (x + (x >> 8)) >> 8;
+    }
+
+    // dst = src * (255 - A) / 255 + C,  over - BGRA   ; src  dst  
+    inline void blendRow(const uchar* src, const uchar* over, uchar* dst, int width) {
+        int x = 0;
+#if CV_SIMD
+        const int lanes = cv::v_uint8::nlanes;
+        const cv::v_uint16 half = cv::vx_setall_u16(128);
+        auto scale = [&](const cv::v_uint8& value, const cv::v_uint8& inverse) {
+            cv::v_uint16 v0, v1, i0, i1;
+            cv::v_expand(value, v0, v1);
+            cv::v_expand(inverse, i0, i1);
+            v0 = v0 * i0 + half;
+            v1 = v1 * i1 + half;
+            return cv::v_pack((v0 + (v0 >> 8)) >> 8, (v1 + (v1 >> 8)) >> 8);
+        };
+        for (; x <= width - lanes; x += lanes) {
+            cv::v_uint8 b, g, r, ob, og, orr, oa;
+            cv::v_load_deinterleave(src + 3 * x, b, g, r);
+            cv::v_load_deinterleave(over + 4 * x, ob, og, orr, oa);
+            cv::v_uint8 inverse = cv::vx_setall_u8(255) - oa;
+            cv::v_store_interleave(dst + 3 * x, scale(b, inverse) + ob, scale(g, inverse) + og, scale(r, inverse) + orr);
+        }
+        cv::vx_cleanup();
+#endif
+        for (; x < width; x++) {
+            const uchar* o = over + 4 * x;
+            int inverse = 255 - o[3];
+            for (int c = 0; c < 3; c++) {
+                dst[3 * x + c] = cv::saturate_cast<uchar>(div255(src[3 * x + c] * inverse) + o[c]);
+            }
+        }
+    }
+
+    //    over   opacity (0..256)   under;
+    //  swapRedBlue  B  R   
+    inline void flattenRow(const uchar* over, uchar* under, int width, int opacity, bool swapRedBlue) {
+        for (int x = 0; x < width; x++) {
+            int o[4];
+            for (int c = 0; c < 4; c++) {
+                o[c] = (over[4 * x + c] * opacity) >> 8;
+            }
+            if (swapRedBlue) {
+                std::swap(o[0], o[2]);
+            }
+            int inverse = 255 - o[3];
+            for (int c = 0; c < 4; c++) {
+                under[4 * x + c] = cv::saturate_cast<uchar>(o[c] + div255(under[4 * x + c] * inverse));
+            }
+        }
+    }
+}
+
+//     BGR.
+//     .      
+//      ;       BGRA-,
+//           ,  .
+class OverlayCompositor {
+public:
+    void setLayers(const std::vector<OverlayLayer>& value) {
+        layers = value;
+        premultiplied.clear();
+        for (const OverlayLayer& layer : layers) {
+            CV_Assert(layer.image.type() == CV_8UC4);
+            premultiplied.push_back(premultiply(layer.image));
+        }
+        resampled.clear();
+        resampledSize = cv::Size();
+        flattened.release();
+    }
+
+    const std::vector<OverlayLayer>& getLayers() const { return layers; }
+
+    // ,    ,    RGB
+    void setRgbOrder(bool value) {
+        if (value != rgbOrder) {
+            rgbOrder = value;
+            flattened.release();
+        }
+    }
+
+    bool empty() const { return layers.empty(); }
+
+    //       size; composite   ,   
+    //      ,     
+    void prepare(cv::Size size, double opacity) {
+        if (size != resampledSize) {
+            //          
+            TRACE_SCOPE("overlay.resample");
+            resampled.clear();
+            rects.clear();
+            for (size_t i = 0; i < layers.size(); i++) {
+                cv::Rect rect = layerRect(layers[i], size);
+                cv::Rect visible = rect & cv::Rect(cv::Point(), size);
+                cv::Mat scaled;
+                if (!visible.empty()) {
+                    int interpolation = rect.width < premultiplied[i].cols ? cv::INTER_AREA : cv::INTER_LINEAR;
+                    cv::resize(premultiplied[i], scaled, rect.size(), 0, 0, interpolation);
+                    scaled = scaled(visible - rect.tl());
+                }
+                resampled.push_back(scaled);
+                rects.push_back(visible);
+            }
+            resampledSize = size;
+            flattened.release();
+        }
+        if (!flattened.empty() && opacity == flattenedOpacity) {
+            return;
+        }
+
+        TRACE_SCOPE("overlay.flatten");
+        bounds = cv::Rect();
+        for (const cv::Rect& rect : rects) {
+            bounds = bounds.empty() ? rect : (rect.empty() ? bounds : (bounds | rect));
+        }
+        flattened.create(std::max(1, bounds.height), std::max(1, bounds.width), CV_8UC4);
+        flattened.setTo(cv::Scalar::all(0));
+        for (size_t i = 0; i < layers.size(); i++) {
+            if (rects[i].empty()) {
+                continue;
+            }
+            int layerOpacity = cvRound(std::min(1.0, std::max(0.0, layers[i].opacity * opacity)) * 256);
+            cv::Rect target = rects[i] - bounds.tl();
+            for (int y = 0; y < target.height; y++) {
+                overlay_kernel::flattenRow(resampled[i].ptr<uchar>(y), flattened.ptr<uchar>(target.y + y) + 4 * target.x,
+                    target.width, layerOpacity, rgbOrder);
+            }
+        }
+        flattenedOpacity = opacity;
+    }
+
+    // output =   input (CV_8UC3, BGR  RGB  setRgbOrder)    opacity;
+    // output    input
+    void composite(const cv::Mat& input, double opacity, cv::Mat& output) {
+        composite(input, opacity, output, input.size(), cv::Point());
+    }
+
+    //  ,  input -   frameSize     offset (   )
+    void composite(const cv::Mat& input, double opacity, cv::Mat& output, cv::Size frameSize, cv::Point offset) {
+        CV_Assert(input.type() == CV_8UC3);
+        if (layers.empty() || opacity <= 0) {
+            output = input;
+            return;
+        }
+        prepare(frameSize, opacity);
+        const cv::Rect area = (bounds - offset) & cv::Rect(cv::Point(), input.size()); //    input
+        if (area.empty()) {
+            output = input; //         
+            return;
+        }
+
+        TRACE_SCOPE("overlay.blend");
+        cv::Mat src = input; // input     ,   output
+        output.create(src.size(), src.type());
+        const bool copy = output.data != src.data;
+        const size_t rowBytes = static_cast<size_t>(src.cols) * 3;
+        const cv::Point layerOffset = area.tl() + offset - bounds.tl(); //  area  flattened
+        cv::parallel_for_(cv::Range(0, src.rows), [&](const cv::Range& range) {
+            for (int y = range.start; y < range.end; y++) {
+                const uchar* in = src.ptr<uchar>(y);
+                uchar* out = output.ptr<uchar>(y);
+                if (y < area.y || y >= area.y + area.height) {
+                    if (copy) {
+                        std::memcpy(out, in, rowBytes);
+                    }
+                    continue;
+                }
+                if (copy) {
+                    std::memcpy(out, in, area.x * 3);
+                    size_t right = (area.x + area.width) * 3;
+                    std::memcpy(out + right, in + right, rowBytes - right);
+                }
+                overlay_kernel::blendRow(in + area.x * 3, flattened.ptr<uchar>(y - area.y + layerOffset.y) + 4 * layerOffset.x,
+                    out + area.x * 3, area.width);
+            }
+            });
+    }
+
+private:
+    static cv::Mat premultiply(const cv::Mat& image) {
+        cv::Mat result(image.size(), CV_8UC4);
+        for (int y = 0; y < image.rows; y++) {
+            const uchar* src = image.ptr<uchar>(y);
+            uchar* dst = result.ptr<uchar>(y);
+            for (int x = 0; x < image.cols; x++) {
+                int alpha = src[4 * x + 3];
+                for (int c = 0; c < 3; c++) {
+                    dst[4 * x + c] = static_cast<uchar>(overlay_kernel::div255(src[4 * x + c] * alpha));
+                }
+                dst[4 * x + 3] = static_cast<uchar>(alpha);
+            }
+        }
+        return result;
+    }
+
+    //      size (    )
+    static cv::Rect layerRect(const OverlayLayer& layer, cv::Size size) {
+        return cv::Rect(cvRound(layer.placement.x * size.width), cvRound(layer.placement.y * size.height),
+            std::max(1, cvRound(layer.placement.width * size.width)), std::max(1, cvRound(layer.placement.height * size.height)));
+    }
+
+    std::vector<OverlayLayer> layers;
+    std::vector<cv::Mat> premultiplied; //       
+    std::vector<cv::Mat> resampled;     //       resampledSize
+    std::vector<cv::Rect> rects;        //    
+    cv::Size resampledSize;
+    cv::Mat flattened;                  //  ,   ,   bounds
+    cv::Rect bounds;
+    double flattenedOpacity = -1;
+    bool rgbOrder = false;
+};
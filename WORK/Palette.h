@@ -0,0 +1,247 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+#include "PixelFormat.h"
+
+//     .
+//      32x32x32 ( 5   )   ,
+//          
+//  k-means    .        :
+//  1    (    uint64    32768 ).
+class Palette {
+public:
+    static std::vector<cv::Vec3b> extractPalette(const cv::Mat& image, int numColors) {
+        if (image.empty() || !isSupportedImageType(image.type())) {
+            throw std::runtime_error("Invalid image for palette extraction");
+        }
+        if (image.type() != CV_8UC3) {
+            cv::Mat colored;
+            expandToBgr8(image, colored);
+            return extractPalette(colored, numColors);
+        }
+        if (numColors < 1) {
+            throw std::runtime_error("Palette size must be positive");
+        }
+
+        Histogram histogram = buildHistogram(image);
+        std::vector<Bin> bins;
+        for (int i = 0; i < BIN_COUNT; i++) {
+            if (histogram.counts[i] > 0) {
+                Bin bin;
+                bin.count = histogram.counts[i];
+                for (int c = 0; c < 3; c++) {
+                    bin.color[c] = static_cast<float>(static_cast<double>(histogram.sums[i * 3 + c]) / bin.count);
+                }
+                bins.push_back(bin);
+            }
+        }
+
+        std::vector<Cluster> clusters = medianCut(bins, numColors);
+        refine(bins, clusters, 3);
+
+        //    
+        std::sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) { return a.count > b.count; });
+        std::vector<cv::Vec3b> palette;
+        for (const Cluster& cluster : clusters) {
+            palette.push_back(cv::Vec3b(cv::saturate_cast<uchar>(cluster.center[0]),
+                cv::saturate_cast<uchar>(cluster.center[1]),
+                cv::saturate_cast<uchar>(cluster.center[2])));
+        }
+        return palette;
+    }
+
+private:
+    enum { BITS = 5, BIN_COUNT = 1 << (3 * BITS) };
+
+    struct Histogram {
+        std::vector<uint64_t> counts;
+        std::vector<uint64_t> sums; //  B, G, R   
+
+        Histogram() : counts(BIN_COUNT, 0), sums(BIN_COUNT * 3, 0) {}
+
+        void merge(const Histogram& other) {
+            for (int i = 0; i < BIN_COUNT; i++) {
+                counts[i] += other.counts[i];
+            }
+            for (int i = 0; i < BIN_COUNT * 3; i++) {
+                sums[i] += other.sums[i];
+            }
+        }
+    };
+
+    struct Bin {
+        float color[3];
+        uint64_t count;
+    };
+
+    struct Cluster {
+        float center[3] = { 0, 0, 0 };
+        uint64_t count = 0;
+    };
+
+    //  :  5   
+    static int binIndex(const uchar* pixel) {
+        return ((pixel[0] >> 3) << 10) | ((pixel[1] >> 3) << 5) | (pixel[2] >> 3);
+    }
+
+    static void accumulateRow(const uchar* row, int width, Histogram& histogram, std::vector<ushort>& indices) {
+        int x = 0;
+#if CV_SIMD
+        //    ,    
+        const int lanes = cv::v_uint8::nlanes;
+        for (; x <= width - lanes; x += lanes) {
+            cv::v_uint8 b, g, r;
+            cv::v_load_deinterleave(row + 3 * x, b, g, r);
+            cv::v_uint16 b0, b1, g0, g1, r0, r1;
+            cv::v_expand(b, b0, b1);
+            cv::v_expand(g, g0, g1);
+            cv::v_expand(r, r0, r1);
+            cv::v_store(&indices[x], ((b0 >> 3) << 10) | ((g0 >> 3) << 5) | (r0 >> 3));
+            cv::v_store(&indices[x + lanes / 2], ((b1 >> 3) << 10) | ((g1 >> 3) << 5) | (r1 >> 3));
+        }
+        for (int i = 0; i < x; i++) {
+            int index = indices[i];
+            const uchar* pixel = row + 3 * i;
+            histogram.counts[index]++;
+            histogram.sums[index * 3] += pixel[0];
+            histogram.sums[index * 3 + 1] += pixel[1];
+            histogram.sums[index * 3 + 2] += pixel[2];
+        }
+#endif
+        for (; x < width; x++) {
+            const uchar* pixel = row + 3 * x;
+            int index = binIndex(pixel);
+            histogram.counts[index]++;
+            histogram.sums[index * 3] += pixel[0];
+            histogram.sums[index * 3 + 1] += pixel[1];
+            histogram.sums[index * 3 + 2] += pixel[2];
+        }
+    }
+
+    //     ,   
+    static Histogram buildHistogram(const cv::Mat& image) {
+        Histogram total;
+        std::mutex mutex;
+        int stripes = std::max(1, std::min(cv::getNumThreads(), image.rows));
+        cv::parallel_for_(cv::Range(0, image.rows), [&](const cv::Range& range) {
+            Histogram local;
+            std::vector<ushort> indices(image.cols + 64);
+            for (int y = range.start; y < range.end; y++) {
+                accumulateRow(image.ptr<uchar>(y), image.cols, local, indices);
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            total.merge(local);
+            }, stripes);
+        return total;
+    }
+
+    //  :           
+    static std::vector<Cluster> medianCut(std::vector<Bin>& bins, int numColors) {
+        struct Box { size_t begin, end; };
+        std::vector<Box> boxes;
+        if (!bins.empty()) {
+            boxes.push_back({ 0, bins.size() });
+        }
+
+        while (static_cast<int>(boxes.size()) < numColors) {
+            int best = -1, bestAxis = 0;
+            float bestRange = 0;
+            for (size_t i = 0; i < boxes.size(); i++) {
+                if (boxes[i].end - boxes[i].begin < 2) {
+                    continue;
+                }
+                for (int c = 0; c < 3; c++) {
+                    float lo = 255, hi = 0;
+                    for (size_t j = boxes[i].begin; j < boxes[i].end; j++) {
+                        lo = std::min(lo, bins[j].color[c]);
+                        hi = std::max(hi, bins[j].color[c]);
+                    }
+                    if (hi - lo > bestRange) {
+                        bestRange = hi - lo;
+                        best = static_cast<int>(i);
+                        bestAxis = c;
+                    }
+                }
+            }
+            if (best < 0) {
+                break; //   ,  
+            }
+
+            Box box = boxes[best];
+            std::sort(bins.begin() + box.begin, bins.begin() + box.end,
+                [bestAxis](const Bin& a, const Bin& b) { return a.color[bestAxis] < b.color[bestAxis]; });
+            uint64_t total = 0;
+            for (size_t j = box.begin; j < box.end; j++) {
+                total += bins[j].count;
+            }
+            uint64_t accumulated = 0;
+            size_t split = box.begin + 1;
+            for (size_t j = box.begin; j < box.end - 1; j++) {
+                accumulated += bins[j].count;
+                split = j + 1;
+                if (accumulated * 2 >= total) {
+                    break;
+                }
+            }
+            boxes[best] = { box.begin, split };
+            boxes.push_back({ split, box.end });
+        }
+
+        std::vector<Cluster> clusters(boxes.size());
+        for (size_t i = 0; i < boxes.size(); i++) {
+            double sum[3] = { 0, 0, 0 };
+            for (size_t j = boxes[i].begin; j < boxes[i].end; j++) {
+                for (int c = 0; c < 3; c++) {
+                    sum[c] += static_cast<double>(bins[j].color[c]) * bins[j].count;
+                }
+                clusters[i].count += bins[j].count;
+            }
+            for (int c = 0; c < 3; c++) {
+                clusters[i].center[c] = static_cast<float>(sum[c] / clusters[i].count);
+            }
+        }
+        return clusters;
+    }
+
+    //   k-means        
+    static void refine(const std::vector<Bin>& bins, std::vector<Cluster>& clusters, int iterations) {
+        for (int iteration = 0; iteration < iterations; iteration++) {
+            std::vector<double> sums(clusters.size() * 3, 0.0);
+            std::vector<uint64_t> counts(clusters.size(), 0);
+            for (const Bin& bin : bins) {
+                size_t nearest = 0;
+                float nearestDistance = 1e30f;
+                for (size_t k = 0; k < clusters.size(); k++) {
+                    float distance = 0;
+                    for (int c = 0; c < 3; c++) {
+                        float d = bin.color[c] - clusters[k].center[c];
+                        distance += d * d;
+                    }
+                    if (distance < nearestDistance) {
+                        nearestDistance = distance;
+                        nearest = k;
+                    }
+                }
+                for (int c = 0; c < 3; c++) {
+                    sums[nearest * 3 + c] += static_cast<double>(bin.color[c]) * bin.count;
+                }
+                counts[nearest] += bin.count;
+            }
+            for (size_t k = 0; k < clusters.size(); k++) {
+                if (counts[k] == 0) {
+                    clusters[k].count = 0; //    ,    
+                    continue;
+                }
+                for (int c = 0; c < 3; c++) {
+                    clusters[k].center[c] = static_cast<float>(sums[k * 3 + c] / counts[k]);
+                }
+                clusters[k].count = counts[k];
+            }
+        }
+    }
+};
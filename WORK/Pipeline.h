@@ -0,0 +1,414 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <vector>
+#include "BufferPool.h"
+#include "ColorKernel.h"
+#include "Overlay.h"
+#include "PixelFormat.h"
+#include "Trace.h"
+#include "ProxyPyramid.h"
+#include "TaskScheduler.h"
+
+//  ,    
+struct AdjustmentParams {
+    double brightness = 1.0; // 
+    double saturation = 1.0; // 
+    int r = 0, g = 0, b = 0; //  RGB 
+    double transparency = 1.0; //    
+    double scaleFactor = 1.0; //  
+};
+
+//        .
+//      ,   ,    .
+//      ,    ,
+//      .
+//         ,    ,
+//        .
+//       ,    
+// (   ),    -   ; 
+//    .       .
+class RenderPipeline {
+public:
+    enum Stage {
+        STAGE_COLOR,   // ,    RGB   
+        STAGE_OVERLAY, //  
+        STAGE_SCALE,   // 
+        STAGE_COUNT
+    };
+
+    // rgbOutput -     RGB    ;  
+    //     ,   .
+    // pool -    (   ),    
+    explicit RenderPipeline(bool rgbOutput = false, BufferPool* pool = nullptr)
+        : rgbOutput(rgbOutput), buffers(pool ? pool : &ownBuffers) {
+        overlays.setRgbOrder(rgbOutput);
+    }
+
+    const AdjustmentParams& getParams() const { return params; }
+    const std::vector<OverlayLayer>& getOverlays() const { return overlays.getLayers(); }
+
+    //     (,  )
+    void setParams(const AdjustmentParams& value) {
+        setBrightness(value.brightness);
+        setSaturation(value.saturation);
+        setRGB(value.r, value.g, value.b);
+        setScale(value.scaleFactor);
+        if (value.transparency != params.transparency) {
+            params.transparency = value.transparency;
+            invalidate(STAGE_OVERLAY);
+        }
+    }
+
+    //   :   .
+    // fullSize -   ,  image -    (  );
+    //      ,       .
+    void setSource(const cv::Mat& image, const cv::Size& fullSize = cv::Size()) {
+        pyramid.build(image);
+        sourceSize = fullSize.empty() ? image.size() : fullSize;
+        invalidate(STAGE_COLOR);
+    }
+
+    //      (  -  )
+    void setViewportSize(const cv::Size& size) {
+        viewportSize = size;
+        invalidate(STAGE_SCALE);
+    }
+
+    void setOverlays(const std::vector<OverlayLayer>& layers) {
+        overlays.setLayers(layers);
+        invalidate(STAGE_OVERLAY);
+    }
+
+    void setBrightness(double value) {
+        if (value != params.brightness) {
+            params.brightness = value;
+            invalidate(STAGE_COLOR);
+        }
+    }
+
+    void setSaturation(double value) {
+        if (value != params.saturation) {
+            params.saturation = value;
+            invalidate(STAGE_COLOR);
+        }
+    }
+
+    void setRGB(int red, int green, int blue) {
+        if (red != params.r || green != params.g || blue != params.b) {
+            params.r = red;
+            params.g = green;
+            params.b = blue;
+            invalidate(STAGE_COLOR);
+        }
+    }
+
+    void setScale(double value) {
+        if (value != params.scaleFactor) {
+            params.scaleFactor = value;
+            invalidate(STAGE_SCALE);
+        }
+    }
+
+    //       delta  
+    // (      )
+    void panBy(const cv::Point& delta) {
+        cv::Rect view = visibleRect();
+        if (view.empty()) {
+            return;
+        }
+        cv::Size display = displaySize();
+        viewCenter.x = std::min(1.0, std::max(0.0, (view.x + view.width / 2.0 - delta.x) / display.width));
+        viewCenter.y = std::min(1.0, std::max(0.0, (view.y + view.height / 2.0 - delta.y) / display.height));
+    }
+
+    //    .     1 -    
+    // (    ),  1 - ;   -   
+    cv::Size displaySize() const {
+        cv::Size full = sourceSize;
+        double factor = params.scaleFactor;
+        if (viewportSize.width > 0 && viewportSize.height > 0 && !full.empty()) {
+            factor *= std::min(1.0, std::min(static_cast<double>(viewportSize.width) / full.width,
+                static_cast<double>(viewportSize.height) / full.height));
+        }
+        return cv::Size(std::max(1, cvRound(full.width * factor)), std::max(1, cvRound(full.height * factor)));
+    }
+
+    //     displaySize(); ,      
+    cv::Rect visibleRect() const {
+        cv::Size display = displaySize();
+        if (viewportSize.width <= 0 || viewportSize.height <= 0 ||
+            (display.width <= viewportSize.width && display.height <= viewportSize.height)) {
+            return cv::Rect();
+        }
+        int width = std::min(display.width, viewportSize.width);
+        int height = std::min(display.height, viewportSize.height);
+        int x = std::min(display.width - width, std::max(0, cvRound(viewCenter.x * display.width - width / 2.0)));
+        int y = std::min(display.height - height, std::max(0, cvRound(viewCenter.y * display.height - height / 2.0)));
+        return cv::Rect(x, y, width, height);
+    }
+
+    //    ;    .
+    //  cancel    ,      
+    //    ;      .
+    const cv::Mat& render(const std::atomic<bool>* cancel = nullptr) {
+        if (pyramid.empty()) {
+            return cancelledFrame;
+        }
+        TRACE_SCOPE("render.frame");
+
+        cv::Rect view = visibleRect();
+        if (!view.empty()) {
+            return renderView(view, cancel);
+        }
+
+        int level = pyramid.levelFor(displaySize());
+        if (level != currentLevel) {
+            currentLevel = level;
+            invalidate(STAGE_COLOR);
+        }
+
+        //    ,        
+        //  ,      
+        TaskGraph graph;
+        int overlayPreparation = -1;
+        if (firstDirty <= STAGE_OVERLAY && !overlays.empty() && params.transparency > 0) {
+            cv::Size size = pyramid.level(currentLevel).size();
+            double opacity = params.transparency;
+            overlayPreparation = graph.add([this, size, opacity] { overlays.prepare(size, opacity); });
+        }
+        int completed = firstDirty; //   completed 
+        int previous = -1;
+        for (int stage = firstDirty; stage < STAGE_COUNT; stage++) {
+            std::vector<int> dependencies;
+            if (previous >= 0) {
+                dependencies.push_back(previous);
+            }
+            if (stage == STAGE_OVERLAY && overlayPreparation >= 0) {
+                dependencies.push_back(overlayPreparation);
+            }
+            previous = graph.add([this, stage, cancel, &completed] {
+                if (completed != stage || (cancel && cancel->load())) {
+                    return; //   
+                }
+                const cv::Mat& input = stage == 0 ? pyramid.level(currentLevel) : outputs[stage - 1];
+                runStage(static_cast<Stage>(stage), input, outputs[stage], cancel);
+                if (!cancel || !cancel->load()) {
+                    completed = stage + 1; //      
+                }
+                }, dependencies);
+        }
+        graph.run();
+        firstDirty = completed;
+        return firstDirty == STAGE_COUNT ? outputs[STAGE_COUNT - 1] : cancelledFrame;
+    }
+
+    //     ( ),   
+    static void renderFullResolution(const cv::Mat& source, const std::vector<OverlayLayer>& layers,
+        const AdjustmentParams& params, cv::Mat& result) {
+        TRACE_SCOPE("render.full_resolution");
+        cv::Mat colored;
+        applyColor(source, colored, params);
+        OverlayCompositor compositor;
+        compositor.setLayers(layers);
+        compositor.composite(colored, params.transparency, result);
+    }
+
+    //  rows  renderFullResolution (       ).
+    // compositor -   ; output -     cv::Mat,   
+    //     source,   
+    static void renderRows(const cv::Mat& source, OverlayCompositor& compositor, const AdjustmentParams& params,
+        const cv::Range& rows, cv::Mat& output) {
+        cv::Mat colored = output;
+        applyColor(source.rowRange(rows), colored, params);
+        compositor.composite(colored, params.transparency, output, source.size(), cv::Point(0, rows.start));
+    }
+
+    //     
+    void invalidate(Stage stage) {
+        firstDirty = std::min(firstDirty, static_cast<int>(stage));
+        viewValid = false; //       
+    }
+
+private:
+    void runStage(Stage stage, const cv::Mat& input, cv::Mat& output, const std::atomic<bool>* cancel) {
+        static const char* const names[STAGE_COUNT] = { "render.color", "render.overlay", "render.scale" };
+        ScopedTimer timer(names[stage]);
+        size_t allocated = 0; //    :     
+
+        //      ,       
+        //    ;    
+        output.release();
+        switch (stage) {
+        case STAGE_COLOR:
+            if (!ColorAdjustment(params.brightness, params.saturation, params.r, params.g, params.b).isIdentity() || rgbOutput ||
+                input.type() != CV_8UC3) {
+                output = buffers->acquire(input.size(), CV_8UC3, &allocated);
+            }
+            applyColor(input, output, params, cancel, rgbOutput);
+            break;
+        case STAGE_OVERLAY:
+            if (!overlays.empty() && params.transparency > 0) {
+                output = buffers->acquire(input.size(), CV_8UC3, &allocated);
+            }
+            overlays.composite(input, params.transparency, output);
+            break;
+        case STAGE_SCALE: {
+            cv::Size target = displaySize();
+            if (input.size() == target) {
+                output = input;
+            }
+            else {
+                output = buffers->acquire(target, CV_8UC3, &allocated);
+                int interpolation = target.width < input.cols ? cv::INTER_AREA : cv::INTER_LINEAR;
+                cv::resize(input, output, target, 0, 0, interpolation);
+            }
+            break;
+        }
+        default:
+            break;
+        }
+        timer.addBytes(allocated); //   
+    }
+
+    //    view:   ,      
+    const cv::Mat& renderView(const cv::Rect& view, const std::atomic<bool>* cancel) {
+        TRACE_SCOPE("render.view");
+        const cv::Size display = displaySize();
+        const int level = pyramid.levelFor(display);
+        cv::Rect kept; //   ,   
+        if (viewValid && display == viewDisplay && level == viewLevel) {
+            if (view == viewRect) {
+                return viewFrame;
+            }
+            kept = view & viewRect;
+        }
+
+        cv::Mat frame = buffers->acquire(view.size(), CV_8UC3);
+        std::vector<cv::Rect> dirty; //   
+        if (kept.empty()) {
+            dirty.push_back(cv::Rect(cv::Point(), view.size()));
+        }
+        else {
+            viewFrame(kept - viewRect.tl()).copyTo(frame(kept - view.tl()));
+            //  :      ,    -    
+            const cv::Rect inner = kept - view.tl();
+            dirty.push_back(cv::Rect(0, 0, view.width, inner.y));
+            dirty.push_back(cv::Rect(0, inner.y + inner.height, view.width, view.height - inner.y - inner.height));
+            dirty.push_back(cv::Rect(0, inner.y, inner.x, inner.height));
+            dirty.push_back(cv::Rect(inner.x + inner.width, inner.y, view.width - inner.x - inner.width, inner.height));
+        }
+        for (const cv::Rect& rect : dirty) {
+            if (cancel && cancel->load()) {
+                return cancelledFrame; //       
+            }
+            if (!rect.empty()) {
+                renderRegion(pyramid.level(level), display, view, rect, frame, cancel);
+            }
+        }
+        if (cancel && cancel->load()) {
+            return cancelledFrame;
+        }
+        viewFrame = frame;
+        viewRect = view;
+        viewDisplay = display;
+        viewLevel = level;
+        viewValid = true;
+        return viewFrame;
+    }
+
+    //   rect    view   display  frame(rect).
+    //           source, 
+    //      ,   cv::resize,     .
+    //        ;     
+    //     ,   INTER_AREA   ,     
+    void renderRegion(const cv::Mat& source, cv::Size display, const cv::Rect& view, const cv::Rect& rect,
+        cv::Mat& frame, const std::atomic<bool>* cancel) {
+        ScopedTimer timer("render.region");
+        size_t allocated = 0;
+        const double sx = static_cast<double>(source.cols) / display.width;
+        const double sy = static_cast<double>(source.rows) / display.height;
+        //  ,        rect
+        const double x0 = (view.x + rect.x + 0.5) * sx - 0.5;
+        const double y0 = (view.y + rect.y + 0.5) * sy - 0.5;
+        const double x1 = (view.x + rect.x + rect.width - 0.5) * sx - 0.5;
+        const double y1 = (view.y + rect.y + rect.height - 0.5) * sy - 0.5;
+        const double blurX = sx > 1 ? 0.5 * std::sqrt(sx * sx - 1) : 0; //   
+        const double blurY = sy > 1 ? 0.5 * std::sqrt(sy * sy - 1) : 0;
+        const int radiusX = cvCeil(3 * blurX), radiusY = cvCeil(3 * blurY);
+        const int halo = 2 + std::max(radiusX, radiusY); //       
+        const cv::Rect area = cv::Rect(cv::Point(cvFloor(x0) - halo, cvFloor(y0) - halo),
+            cv::Point(cvCeil(x1) + halo + 1, cvCeil(y1) + halo + 1)) & cv::Rect(cv::Point(), source.size());
+
+        cv::Mat colored;
+        if (!ColorAdjustment(params.brightness, params.saturation, params.r, params.g, params.b).isIdentity() || rgbOutput ||
+            source.type() != CV_8UC3) {
+            colored = buffers->acquire(area.size(), CV_8UC3, &allocated);
+        }
+        applyColor(source(area), colored, params, cancel, rgbOutput);
+        cv::Mat composited;
+        if (!overlays.empty() && params.transparency > 0) {
+            composited = buffers->acquire(area.size(), CV_8UC3, &allocated);
+        }
+        overlays.composite(colored, params.transparency, composited, source.size(), area.tl());
+        if (radiusX > 0 || radiusY > 0) {
+            cv::Mat smoothed = buffers->acquire(area.size(), CV_8UC3, &allocated);
+            cv::GaussianBlur(composited, smoothed, cv::Size(2 * radiusX + 1, 2 * radiusY + 1), std::max(blurX, 1e-3), std::max(blurY, 1e-3),
+                cv::BORDER_REPLICATE);
+            composited = smoothed;
+        }
+
+        cv::Mat target = frame(rect);
+        const cv::Matx23d transform(sx, 0, x0 - area.x, 0, sy, y0 - area.y);
+        cv::warpAffine(composited, target, transform, rect.size(), cv::INTER_LINEAR | cv::WARP_INVERSE_MAP, cv::BORDER_REPLICATE);
+        timer.addBytes(allocated);
+    }
+
+    //  .     (, BGRA, 16 )   8- BGR
+    //  : ,      CV_8UC3
+    static void applyColor(const cv::Mat& input, cv::Mat& output, const AdjustmentParams& params,
+        const std::atomic<bool>* cancel = nullptr, bool swapRedBlue = false) {
+        ColorAdjustment adjustment(params.brightness, params.saturation, params.r, params.g, params.b);
+        if (input.type() != CV_8UC3) {
+            const bool identity = adjustment.isIdentity();
+            expandToBgr8(input, output, swapRedBlue && identity);
+            if (!identity) {
+                adjustment.swapRedBlue = swapRedBlue;
+                applyColorAdjustment(output, output, adjustment, cancel);
+            }
+        }
+        else if (adjustment.isIdentity()) {
+            if (swapRedBlue) {
+                cv::cvtColor(input, output, cv::COLOR_BGR2RGB);
+            }
+            else {
+                output = input;
+            }
+        }
+        else {
+            adjustment.swapRedBlue = swapRedBlue;
+            applyColorAdjustment(input, output, adjustment, cancel);
+        }
+    }
+
+    bool rgbOutput;
+    BufferPool ownBuffers; // ,    
+    BufferPool* buffers;
+    ProxyPyramid pyramid;
+    cv::Size sourceSize; //   
+    int currentLevel = 0; //  ,    
+    cv::Size viewportSize;
+    OverlayCompositor overlays; //       
+    AdjustmentParams params;
+    cv::Mat outputs[STAGE_COUNT];
+    cv::Mat cancelledFrame; //  
+    int firstDirty = STAGE_COLOR;
+    cv::Point2d viewCenter = cv::Point2d(0.5, 0.5); //      
+    cv::Mat viewFrame;   //    
+    cv::Rect viewRect;   //      viewDisplay
+    cv::Size viewDisplay;
+    int viewLevel = 0;
+    bool viewValid = false; //      viewFrame
+};
@@ -0,0 +1,158 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <stdexcept>
+
+//     : 1  (), 3 (BGR)  4 (BGRA), 8  16   .
+//   8-       (. expandToBgr8).
+inline bool isSupportedImageType(int type) {
+    const int depth = CV_MAT_DEPTH(type);
+    const int channels = CV_MAT_CN(type);
+    return (depth == CV_8U || depth == CV_16U) && (channels == 1 || channels == 3 || channels == 4);
+}
+
+//    ,   :   T    CN
+template<typename T, int CN>
+struct PixelFormat {
+    typedef T Value;
+    enum {
+        CHANNELS = CN,
+        COLOR_CHANNELS = CN == 4 ? 3 : CN, // -   
+        MAX_VALUE = sizeof(T) == 1 ? 255 : 65535
+    };
+};
+
+//  kernel(PixelFormat<T, CN>())   type;   - 
+template<typename Kernel>
+void dispatchPixelFormat(int type, Kernel&& kernel) {
+    switch (type) {
+    case CV_8UC1: kernel(PixelFormat<uchar, 1>()); break;
+    case CV_8UC3: kernel(PixelFormat<uchar, 3>()); break;
+    case CV_8UC4: kernel(PixelFormat<uchar, 4>()); break;
+    case CV_16UC1: kernel(PixelFormat<ushort, 1>()); break;
+    case CV_16UC3: kernel(PixelFormat<ushort, 3>()); break;
+    case CV_16UC4: kernel(PixelFormat<ushort, 4>()); break;
+    default:
+        throw std::runtime_error("Unsupported image format");
+    }
+}
+
+namespace pixel_kernel {
+    //    8   
+    inline uchar toByte(uchar v) { return v; }
+    inline uchar toByte(ushort v) { return static_cast<uchar>((v * 255u + 32767u) / 65535u); }
+
+    //   8- BGR (rgb -  RGB);     ,  
+    template<typename T, int CN>
+    void expandRow(const T* src, uchar* dst, int width, bool rgb) {
+        const int first = rgb ? 2 : 0;
+        for (int x = 0; x < width; x++, src += CN, dst += 3) {
+            if (CN == 1) {
+                dst[0] = dst[1] = dst[2] = toByte(src[0]);
+            }
+            else {
+                dst[first] = toByte(src[0]);
+                dst[1] = toByte(src[1]);
+                dst[2 - first] = toByte(src[2]);
+            }
+        }
+    }
+
+    //      
+    template<typename T, int CN>
+    void invertRow(T* row, int width) {
+        typedef PixelFormat<T, CN> Format;
+        for (int x = 0; x < width; x++, row += CN) {
+            for (int c = 0; c < Format::COLOR_CHANNELS; c++) {
+                row[c] = static_cast<T>(Format::MAX_VALUE - row[c]);
+            }
+        }
+    }
+
+    //     : value' = value * scale[c] + offset[c] (  )
+    template<typename T, int CN>
+    void levelsRow(T* row, int width, const float* scale, const float* offset) {
+        typedef PixelFormat<T, CN> Format;
+        for (int x = 0; x < width; x++, row += CN) {
+            for (int c = 0; c < Format::COLOR_CHANNELS; c++) {
+                row[c] = cv::saturate_cast<T>(row[c] * scale[c] + offset[c]);
+            }
+        }
+    }
+
+    //   kernel(row, width)    image  Format
+    template<typename Format, typename RowKernel>
+    void forEachRow(cv::Mat& image, RowKernel&& kernel) {
+        cv::parallel_for_(cv::Range(0, image.rows), [&](const cv::Range& range) {
+            for (int y = range.start; y < range.end; y++) {
+                kernel(image.ptr<typename Format::Value>(y), image.cols);
+            }
+            });
+    }
+}
+
+//  src  8- BGR (rgb -  RGB)    ,   .
+// dst     src,  ,  src  CV_8UC3    
+inline void expandToBgr8(const cv::Mat& src, cv::Mat& dst, bool rgb = false) {
+    if (src.depth() == CV_8U) {
+        //  OpenCV 
+        switch (src.channels()) {
+        case 1:
+            cv::cvtColor(src, dst, cv::COLOR_GRAY2BGR);
+            return;
+        case 3:
+            if (rgb) {
+                cv::cvtColor(src, dst, cv::COLOR_BGR2RGB);
+            }
+            else if (dst.data != src.data) {
+                src.copyTo(dst);
+            }
+            return;
+        case 4:
+            cv::cvtColor(src, dst, rgb ? cv::COLOR_BGRA2RGB : cv::COLOR_BGRA2BGR);
+            return;
+        default:
+            break;
+        }
+    }
+    dispatchPixelFormat(src.type(), [&](auto format) {
+        typedef decltype(format) Format;
+        dst.create(src.size(), CV_8UC3);
+        cv::parallel_for_(cv::Range(0, src.rows), [&](const cv::Range& range) {
+            for (int y = range.start; y < range.end; y++) {
+                pixel_kernel::expandRow<typename Format::Value, Format::CHANNELS>(
+                    src.ptr<typename Format::Value>(y), dst.ptr<uchar>(y), src.cols, rgb);
+            }
+            });
+        });
+}
+
+//      :   (0..1)
+//     8  16 ,   (  ) -  
+inline cv::Mat normalizeImageFormat(const cv::Mat& image) {
+    if (image.empty() || isSupportedImageType(image.type())) {
+        return image;
+    }
+    cv::Mat result = image;
+    if (result.channels() == 2) {
+        cv::extractChannel(result, result, 0);
+    }
+    else if (result.channels() > 4) {
+        throw std::runtime_error("Unsupported number of image channels");
+    }
+    switch (result.depth()) {
+    case CV_8U:
+    case CV_16U:
+        break;
+    case CV_8S:
+        result.convertTo(result, CV_8U);
+        break;
+    case CV_32F:
+    case CV_64F:
+        result.convertTo(result, CV_16U, 65535.0);
+        break;
+    default:
+        result.convertTo(result, CV_16U);
+        break;
+    }
+    return result;
+}
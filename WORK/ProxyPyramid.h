@@ -0,0 +1,43 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <vector>
+
+//      .
+//  0 -  ,     .
+class ProxyPyramid {
+public:
+    void build(const cv::Mat& image, int minSide = 256) {
+        levels.clear();
+        if (image.empty()) {
+            return;
+        }
+        levels.push_back(image);
+        while (std::min(levels.back().cols, levels.back().rows) / 2 >= minSide) {
+            const cv::Mat& previous = levels.back();
+            cv::Mat next;
+            cv::resize(previous, next, cv::Size((previous.cols + 1) / 2, (previous.rows + 1) / 2), 0, 0, cv::INTER_AREA);
+            levels.push_back(next);
+        }
+    }
+
+    void clear() { levels.clear(); }
+    bool empty() const { return levels.empty(); }
+    int size() const { return static_cast<int>(levels.size()); }
+    const cv::Mat& level(int index) const { return levels[index]; }
+    cv::Size fullSize() const { return levels.empty() ? cv::Size() : levels[0].size(); }
+
+    //  ,     
+    int levelFor(const cv::Size& target) const {
+        int index = 0;
+        for (int i = 1; i < size(); i++) {
+            if (levels[i].cols < target.width || levels[i].rows < target.height) {
+                break;
+            }
+            index = i;
+        }
+        return index;
+    }
+
+private:
+    std::vector<cv::Mat> levels;
+};
@@ -0,0 +1,270 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "Convolution.h"
+#include "FilterChain.h"
+#include "Filters.h"
+#include "Pipeline.h"
+
+//        (  ): "blur 60".
+//     - 
+inline std::unique_ptr<Filter> createFilter(const std::string& spec) {
+    std::istringstream in(spec);
+    std::string name;
+    in >> name;
+    auto expectEnd = [&] {
+        if (!(in >> std::ws).eof()) {
+            throw std::runtime_error("Unexpected text after filter parameters: " + spec);
+        }
+    };
+    if (name == "blur") {
+        int radius = 7;
+        if (!(in >> std::ws).eof() && !(in >> radius)) {
+            throw std::runtime_error("Invalid blur radius: " + spec);
+        }
+        expectEnd();
+        return std::make_unique<BlurFilter>(radius);
+    }
+    if (name == "levels") {
+        int values[6];
+        for (int& value : values) {
+            if (!(in >> value) || value < 0 || value > 255) {
+                throw std::runtime_error("Invalid levels: " + spec);
+            }
+        }
+        expectEnd();
+        return std::make_unique<LevelsFilter>(cv::Vec3b(values[0], values[1], values[2]), cv::Vec3b(values[3], values[4], values[5]));
+    }
+    if (name == "kernel") {
+        int width = 0, height = 0;
+        if (!(in >> width >> height) || width < 1 || height < 1 || width > 1023 || height > 1023) {
+            throw std::runtime_error("Invalid kernel size: " + spec);
+        }
+        cv::Mat values(height, width, CV_32F);
+        for (int i = 0; i < width * height; i++) {
+            if (!(in >> values.at<float>(i / width, i % width))) {
+                throw std::runtime_error("Kernel needs " + std::to_string(width * height) + " values: " + spec);
+            }
+        }
+        expectEnd();
+        return std::make_unique<ConvolutionFilter>(values);
+    }
+    if (name == "psf") {
+        std::string path;
+        std::getline(in >> std::ws, path);
+        path.erase(path.find_last_not_of(" \t\r") + 1);
+        return ConvolutionFilter::fromImage(path);
+    }
+    std::unique_ptr<Filter> filter;
+    if (name == "grayscale") filter = std::make_unique<GrayscaleFilter>();
+    else if (name == "sharpen") filter = std::make_unique<SharpenFilter>();
+    else if (name == "invert") filter = std::make_unique<InvertFilter>();
+    else if (name == "mirror") filter = std::make_unique<MirrorFilter>();
+    else throw std::runtime_error("Unknown filter: " + name);
+    expectEnd();
+    return filter;
+}
+
+//  :     .
+//  ,    , '#' - :
+//   source = photo.jpg (   ;     )
+//   filter = blur 60   ( ,   7)
+//   filter = levels 12 10 8 240 250 245   ( B G R   , . LevelsFilter)
+//   filter = kernel 3 3 -2 -1 0 -1 1 1 0 1 2   (: ,     , . ConvolutionFilter)
+//   filter = psf blur.png   (    ,    1)
+//   brightness = 1.2
+//   saturation = 0.8
+//   rgb = 10 0 -5
+//   scale = 0.5
+//   transparency = 0.8                  (  )
+//   overlay = logo.png 0.5              ( )
+//   overlay = logo.png 1 0.7 0.7 0.25 0.25  (  x y w h   )
+//   overlay = "C:\Logos\Big logo.png" 0.5   (   -  )
+//  overlay    .
+struct Recipe {
+    std::string source;
+    std::vector<std::string> filters;
+    AdjustmentParams params;
+    struct OverlaySpec {
+        std::string path;
+        double opacity = 1.0;
+        cv::Rect2d placement = cv::Rect2d(0, 0, 1, 1);
+    };
+
+    std::vector<OverlaySpec> overlays;
+
+    static Recipe load(const std::string& path) {
+        std::ifstream file(path);
+        if (!file) {
+            throw std::runtime_error("Failed to open recipe: " + path);
+        }
+        return parse(file);
+    }
+
+    static Recipe parse(std::istream& in) {
+        Recipe recipe;
+        std::string line;
+        int lineNumber = 0;
+        while (std::getline(in, line)) {
+            lineNumber++;
+            size_t comment = line.find('#');
+            if (comment != std::string::npos) {
+                line.erase(comment);
+            }
+            size_t separator = line.find('=');
+            if (separator == std::string::npos) {
+                if (line.find_first_not_of(" \t\r") != std::string::npos) {
+                    throw std::runtime_error("Recipe line " + std::to_string(lineNumber) + ": expected key = value");
+                }
+                continue;
+            }
+
+            std::string key;
+            std::istringstream(line.substr(0, separator)) >> key;
+            std::istringstream value(line.substr(separator + 1));
+            bool ok = true;
+            if (key == "source") {
+                std::getline(value >> std::ws, recipe.source);
+                recipe.source.erase(recipe.source.find_last_not_of(" \t\r") + 1);
+                ok = !recipe.source.empty();
+            }
+            else if (key == "filter") {
+                std::string spec;
+                std::getline(value >> std::ws, spec);
+                spec.erase(spec.find_last_not_of(" \t\r") + 1);
+                ok = !spec.empty();
+                if (ok) {
+                    createFilter(spec); //      
+                    recipe.filters.push_back(spec);
+                }
+            }
+            else if (key == "brightness") {
+                ok = static_cast<bool>(value >> recipe.params.brightness);
+            }
+            else if (key == "saturation") {
+                ok = static_cast<bool>(value >> recipe.params.saturation);
+            }
+            else if (key == "rgb") {
+                ok = static_cast<bool>(value >> recipe.params.r >> recipe.params.g >> recipe.params.b);
+            }
+            else if (key == "scale") {
+                ok = static_cast<bool>(value >> recipe.params.scaleFactor) && recipe.params.scaleFactor > 0;
+            }
+            else if (key == "transparency") {
+                ok = static_cast<bool>(value >> recipe.params.transparency);
+            }
+            else if (key == "overlay") {
+                OverlaySpec overlay;
+                if ((value >> std::ws).peek() == '"') {
+                    value.get();
+                    ok = static_cast<bool>(std::getline(value, overlay.path, '"')) && value >> overlay.opacity;
+                }
+                else {
+                    ok = static_cast<bool>(value >> overlay.path >> overlay.opacity);
+                }
+                double x, y, w, h;
+                if (ok && value >> x) {
+                    ok = static_cast<bool>(value >> y >> w >> h) && w > 0 && h > 0;
+                    overlay.placement = cv::Rect2d(x, y, w, h);
+                }
+                recipe.overlays.push_back(overlay);
+            }
+            else {
+                throw std::runtime_error("Recipe line " + std::to_string(lineNumber) + ": unknown key '" + key + "'");
+            }
+            if (!ok) {
+                throw std::runtime_error("Recipe line " + std::to_string(lineNumber) + ": invalid value for '" + key + "'");
+            }
+        }
+        return recipe;
+    }
+
+    void save(const std::string& path) const {
+        std::ofstream file(path);
+        write(file);
+        if (!file) {
+            throw std::runtime_error("Failed to write recipe: " + path);
+        }
+    }
+
+    //     ,   parse (    '#',   - '"')
+    void write(std::ostream& out) const {
+        out << std::setprecision(std::numeric_limits<double>::max_digits10);
+        if (!source.empty()) {
+            out << "source = " << source << "\n";
+        }
+        for (const std::string& spec : filters) {
+            out << "filter = " << spec << "\n";
+        }
+        out << "brightness = " << params.brightness << "\n"
+            << "saturation = " << params.saturation << "\n"
+            << "rgb = " << params.r << " " << params.g << " " << params.b << "\n"
+            << "scale = " << params.scaleFactor << "\n"
+            << "transparency = " << params.transparency << "\n";
+        for (const OverlaySpec& overlay : overlays) {
+            if (overlay.path.find('"') != std::string::npos) {
+                throw std::runtime_error("Overlay path cannot be saved in a recipe: " + overlay.path);
+            }
+            out << "overlay = \"" << overlay.path << "\" " << overlay.opacity << " " << overlay.placement.x << " "
+                << overlay.placement.y << " " << overlay.placement.width << " " << overlay.placement.height << "\n";
+        }
+    }
+
+    //   ; ,    
+    std::vector<OverlayLayer> loadOverlays() const {
+        std::vector<OverlayLayer> layers;
+        for (const OverlaySpec& spec : overlays) {
+            OverlayLayer layer;
+            layer.image = loadOverlayImage(spec.path);
+            if (layer.image.empty()) {
+                throw std::runtime_error("Failed to load overlay image: " + spec.path);
+            }
+            layer.opacity = spec.opacity;
+            layer.placement = spec.placement;
+            layer.source = spec.path;
+            layers.push_back(layer);
+        }
+        return layers;
+    }
+
+    std::vector<std::unique_ptr<Filter>> createFilters() const {
+        std::vector<std::unique_ptr<Filter>> chain;
+        for (const std::string& spec : filters) {
+            chain.push_back(createFilter(spec));
+        }
+        return chain;
+    }
+
+    //       
+    FilterChain createChain() const {
+        std::vector<std::unique_ptr<Filter>> chain = createFilters();
+        chain.push_back(std::make_unique<ColorAdjustmentFilter>(
+            ColorAdjustment(params.brightness, params.saturation, params.r, params.g, params.b)));
+        return FilterChain(std::move(chain));
+    }
+
+    //     : , ,   .
+    // image    .       
+    // (,   grayscale),    8- BGR.
+    cv::Mat apply(cv::Mat image, const std::vector<OverlayLayer>& layers) const {
+        createChain().apply(image);
+        cv::Mat result = image;
+        if (!layers.empty() && params.transparency > 0) {
+            AdjustmentParams overlayOnly; //    
+            overlayOnly.transparency = params.transparency;
+            RenderPipeline::renderFullResolution(image, layers, overlayOnly, result);
+        }
+        if (params.scaleFactor != 1.0) {
+            int interpolation = params.scaleFactor < 1.0 ? cv::INTER_AREA : cv::INTER_LINEAR;
+            cv::resize(result, result, cv::Size(), params.scaleFactor, params.scaleFactor, interpolation);
+        }
+        return result;
+    }
+};
@@ -0,0 +1,169 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "Pipeline.h"
+#include "Statistics.h"
+
+//    .
+//        ;   ,
+//      (  ),    .
+//      ,      .
+class RenderWorker {
+public:
+    //    ,    
+    typedef std::function<void()> FrameReadyCallback;
+
+    // rgbOutput -    RGB,   fl_draw_image; pool - . RenderPipeline
+    explicit RenderWorker(FrameReadyCallback callback, bool rgbOutput = false, BufferPool* pool = nullptr)
+        : onFrameReady(callback), rgbOutput(rgbOutput), pipeline(rgbOutput, pool), thread(&RenderWorker::run, this) {}
+
+    ~RenderWorker() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            cancel = true;
+        }
+        wake.notify_one();
+        thread.join();
+    }
+
+    RenderWorker(const RenderWorker&) = delete;
+    RenderWorker& operator=(const RenderWorker&) = delete;
+
+    //   ;      .
+    // fullSize - . RenderPipeline::setSource
+    void setSource(const cv::Mat& image, const cv::Size& fullSize = cv::Size()) {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.source = image;
+        pending.sourceSize = fullSize;
+        pending.sourceChanged = true;
+    }
+
+    void setOverlays(const std::vector<OverlayLayer>& layers) {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.overlays = layers;
+        pending.overlayChanged = true;
+    }
+
+    void setViewportSize(const cv::Size& size) {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.viewportSize = size;
+        pending.viewportChanged = true;
+    }
+
+    //   ;     
+    void panBy(const cv::Point& delta) {
+        std::lock_guard<std::mutex> lock(mutex);
+        pending.pan += delta;
+    }
+
+    //     ;   
+    void requestRender(const AdjustmentParams& params) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending.params = params;
+            hasPending = true;
+            cancel = true;
+        }
+        wake.notify_one();
+    }
+
+    //     ,  ,   ( )
+    bool takeFrame(cv::Mat& result, ImageStatistics* statistics = nullptr) {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!frameReady) {
+            return false;
+        }
+        result = frame;
+        if (statistics) {
+            *statistics = frameStatistics;
+        }
+        frame.release();
+        frameReady = false;
+        return true;
+    }
+
+private:
+    struct Request {
+        AdjustmentParams params;
+        cv::Mat source;
+        cv::Size sourceSize;
+        bool sourceChanged = false;
+        std::vector<OverlayLayer> overlays;
+        bool overlayChanged = false;
+        cv::Size viewportSize;
+        bool viewportChanged = false;
+        cv::Point pan;
+    };
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            wake.wait(lock, [this] { return stopping || hasPending; });
+            if (stopping) {
+                return;
+            }
+            Request request = pending;
+            pending = Request();
+            hasPending = false;
+            cancel = false;
+            lock.unlock();
+
+            cv::Mat result;
+            ImageStatistics statistics;
+            try {
+                if (request.sourceChanged) {
+                    pipeline.setSource(request.source, request.sourceSize);
+                }
+                if (request.overlayChanged) {
+                    pipeline.setOverlays(request.overlays);
+                }
+                if (request.viewportChanged) {
+                    pipeline.setViewportSize(request.viewportSize);
+                }
+                pipeline.setParams(request.params);
+                if (request.pan != cv::Point()) {
+                    pipeline.panBy(request.pan); //  :       
+                }
+                result = pipeline.render(&cancel);
+                if (!result.empty()) {
+                    TRACE_SCOPE("statistics.frame");
+                    statistics = StatisticsEngine::measure(result, rgbOutput);
+                }
+            }
+            catch (const std::exception&) {
+                result.release(); //  ,   
+            }
+
+            lock.lock();
+            if (result.empty()) {
+                continue; //      
+            }
+            frame = result; //     ,     
+            frameStatistics = statistics;
+            frameReady = true;
+            lock.unlock();
+            onFrameReady();
+            lock.lock();
+        }
+    }
+
+    FrameReadyCallback onFrameReady;
+    const bool rgbOutput;
+    RenderPipeline pipeline; //    
+    std::mutex mutex;
+    std::condition_variable wake;
+    Request pending;
+    bool hasPending = false;
+    bool stopping = false;
+    std::atomic<bool> cancel{ false };
+    cv::Mat frame;
+    ImageStatistics frameStatistics;
+    bool frameReady = false;
+    std::thread thread; //  ,    
+};
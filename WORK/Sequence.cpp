@@ -0,0 +1,114 @@
+//         .
+//
+//   work_sequence --recipe edit.txt [--threads N] [--workers N] [--frames-in-flight N] [--fps F]
+//                 [--codec FOURCC] [--quality Q] [--trace FILE] INPUT OUTPUT
+//
+// INPUT  OUTPUT -         (frames/img_%04d.png).
+// ,      (. processSequence  Sequence.h);  
+//    ,   ,     .
+// --threads -      , --workers - , 
+// , --frames-in-flight -     .
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "Recipe.h"
+#include "Sequence.h"
+#include "TaskScheduler.h"
+#include "Trace.h"
+
+namespace {
+
+    struct SequenceOptions {
+        std::string recipePath;
+        std::string input;
+        std::string output;
+        int threads = 0;
+        std::string tracePath;
+        SequenceSettings settings;
+    };
+
+    void printUsage() {
+        std::cerr << "Usage: work_sequence --recipe FILE [--threads N] [--workers N] [--frames-in-flight N] [--fps F] [--codec FOURCC] [--quality Q] [--trace FILE] INPUT OUTPUT\n";
+    }
+
+    bool parseArguments(int argc, char** argv, SequenceOptions& options) {
+        std::vector<std::string> paths;
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--recipe" && hasValue) options.recipePath = argv[++i];
+            else if (arg == "--threads" && hasValue) options.threads = std::stoi(argv[++i]);
+            else if (arg == "--workers" && hasValue) options.settings.workers = std::stoi(argv[++i]);
+            else if (arg == "--frames-in-flight" && hasValue) options.settings.framesInFlight = std::stoi(argv[++i]);
+            else if (arg == "--fps" && hasValue) options.settings.fps = std::stod(argv[++i]);
+            else if (arg == "--codec" && hasValue) options.settings.fourcc = argv[++i];
+            else if (arg == "--quality" && hasValue) options.settings.encoding.jpegQuality = std::stoi(argv[++i]);
+            else if (arg == "--trace" && hasValue) options.tracePath = argv[++i];
+            else if (arg.compare(0, 2, "--") == 0) return false;
+            else paths.push_back(arg);
+        }
+        if (paths.size() != 2) {
+            return false;
+        }
+        options.input = paths[0];
+        options.output = paths[1];
+        return !options.recipePath.empty();
+    }
+}
+
+int main(int argc, char** argv) {
+    SequenceOptions options;
+    bool parsed = false;
+    try {
+        parsed = parseArguments(argc, argv, options);
+    }
+    catch (const std::exception&) {
+        parsed = false; //   
+    }
+    if (!parsed) {
+        printUsage();
+        return 2;
+    }
+
+    if (!options.tracePath.empty()) {
+        Tracer::instance().startTrace(options.tracePath);
+    }
+    options.settings.encoding.pngCompression = 1; //   
+    TaskScheduler::install(options.threads); //  cv::parallel_for_     
+
+    SequenceStats stats;
+    try {
+        Recipe recipe = Recipe::load(options.recipePath);
+        std::vector<OverlayLayer> overlays = recipe.loadOverlays();
+        stats = processSequence(options.input, options.output, recipe, overlays, options.settings, [](int frames) {
+            if (frames % 100 == 0) {
+                std::cerr << frames << " frames\r" << std::flush;
+            }
+            });
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    std::cout << stats.frames << " frames in " << stats.seconds << " s ("
+        << (stats.seconds > 0 ? stats.frames / stats.seconds : 0.0) << " frames/s)\n";
+    static const char* const names[SequenceStats::STAGE_COUNT] = { "decode", "process", "encode" };
+    for (int stage = 0; stage < SequenceStats::STAGE_COUNT; stage++) {
+        //      :      
+        double perFrame = stats.frames > 0 ? stats.stageSeconds[stage] * 1000.0 / stats.frames : 0.0;
+        if (stage == SequenceStats::STAGE_PROCESS) {
+            perFrame /= std::max(1, options.settings.workers);
+        }
+        std::cout << "  " << std::left << std::setw(8) << names[stage] << std::fixed << std::setprecision(2)
+            << perFrame << " ms/frame\n";
+    }
+    if (!options.tracePath.empty()) {
+        Tracer::instance().printStats(std::cerr);
+        Tracer::instance().writeTrace();
+    }
+    return 0;
+}
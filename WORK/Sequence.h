@@ -0,0 +1,273 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <functional>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BoundedQueue.h"
+#include "Export.h"
+#include "PixelFormat.h"
+#include "Recipe.h"
+#include "Trace.h"
+
+//      
+struct SequenceSettings {
+    int framesInFlight = 6;  //       
+    int workers = 2;         //  :    
+    double fps = 0;          //   ; 0 -    (25,     )
+    std::string fourcc;      //     ;  -   
+    ExportSettings encoding; //      
+};
+
+//  :  ,       .
+//   ,        ,     
+struct SequenceStats {
+    enum Stage { STAGE_DECODE, STAGE_PROCESS, STAGE_ENCODE, STAGE_COUNT };
+
+    int frames = 0;
+    double seconds = 0;
+    double stageSeconds[STAGE_COUNT] = {}; //   -    
+};
+
+//    :   cv::VideoWriter ,        printf
+// (, out/frame_%04d.png),      0
+class FrameWriter {
+public:
+    FrameWriter(const std::string& path, double fps, const SequenceSettings& settings)
+        : path(path), fps(fps), settings(settings) {
+        const size_t percent = path.find('%');
+        numbered = percent != std::string::npos;
+        if (numbered) {
+            //      %d  %0Nd
+            size_t end = percent + 1;
+            while (end < path.size() && std::isdigit(static_cast<unsigned char>(path[end]))) {
+                end++;
+            }
+            if (end >= path.size() || path[end] != 'd' || path.find('%', end) != std::string::npos) {
+                throw std::runtime_error("Frame number in output path must look like %04d: " + path);
+            }
+        }
+        ext = path.substr(std::min(path.size(), path.find_last_of('.')));
+        std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    }
+
+    void write(const cv::Mat& frame) {
+        if (numbered) {
+            std::vector<char> name(path.size() + 32);
+            std::snprintf(name.data(), name.size(), path.c_str(), count);
+            if (!cv::imwrite(name.data(), encodableImage(frame, ext), encoderParams(ext, settings.encoding))) {
+                throw std::runtime_error(std::string("Failed to write ") + name.data());
+            }
+        }
+        else {
+            //    8- BGR   
+            cv::Mat data = frame;
+            if (data.type() != CV_8UC3 && data.type() != CV_8UC1) {
+                expandToBgr8(frame, data);
+            }
+            if (!video.isOpened()) {
+                frameSize = data.size();
+                if (!video.open(path, fourcc(), fps, frameSize, data.channels() == 3)) {
+                    throw std::runtime_error("Failed to create video " + path);
+                }
+            }
+            if (data.size() != frameSize) {
+                throw std::runtime_error("Frame size changed within the sequence");
+            }
+            video.write(data);
+        }
+        count++;
+    }
+
+private:
+    int fourcc() const {
+        std::string code = settings.fourcc;
+        if (code.empty()) {
+            code = ext == ".mp4" || ext == ".m4v" || ext == ".mov" ? "mp4v" : "MJPG";
+        }
+        if (code.size() != 4) {
+            throw std::runtime_error("Video codec must be four characters: " + code);
+        }
+        return cv::VideoWriter::fourcc(code[0], code[1], code[2], code[3]);
+    }
+
+    std::string path;
+    std::string ext;
+    double fps;
+    SequenceSettings settings;
+    bool numbered = false;
+    int count = 0;
+    cv::VideoWriter video;
+    cv::Size frameSize;
+};
+
+//      ( printf,  in/frame_%04d.png)
+// : , ,   ,   work_batch.
+// ,    -     ,   
+// .    ,     ,  
+//    .    settings.workers ,  
+//   .     settings.framesInFlight ,     
+//   . progress     (  ).
+inline SequenceStats processSequence(const std::string& inputPath, const std::string& outputPath,
+    const Recipe& recipe, const std::vector<OverlayLayer>& overlays, const SequenceSettings& settings,
+    const std::function<void(int frames)>& progress = nullptr) {
+    typedef std::chrono::steady_clock Clock;
+    auto elapsed = [](Clock::time_point start) { return std::chrono::duration<double>(Clock::now() - start).count(); };
+    const Clock::time_point start = Clock::now();
+
+    cv::VideoCapture capture(inputPath);
+    if (!capture.isOpened()) {
+        throw std::runtime_error("Failed to open " + inputPath);
+    }
+    double fps = settings.fps > 0 ? settings.fps : capture.get(cv::CAP_PROP_FPS);
+    FrameWriter writer(outputPath, fps > 0 ? fps : 25.0, settings);
+
+    struct Frame {
+        int index = 0;
+        cv::Mat image;
+    };
+    const int inFlightLimit = std::max(1, settings.framesInFlight);
+    const int workerCount = std::max(1, settings.workers);
+    BoundedQueue<Frame> decoded(inFlightLimit), processed(inFlightLimit);
+    SequenceStats stats;
+
+    //    :  ,     .    
+    //       ,       
+    std::mutex windowMutex;
+    std::condition_variable windowFreed;
+    int inFlight = 0;
+
+    std::atomic<bool> failed(false);
+    std::mutex errorMutex;
+    std::string error;
+    auto fail = [&](const std::string& message) {
+        {
+            std::lock_guard<std::mutex> lock(errorMutex);
+            if (error.empty()) {
+                error = message;
+            }
+        }
+        {
+            std::lock_guard<std::mutex> lock(windowMutex);
+            failed = true;
+        }
+        windowFreed.notify_all();
+        decoded.close();
+        processed.close();
+    };
+
+    std::thread decoder([&] {
+        try {
+            for (int index = 0; ; index++) {
+                {
+                    std::unique_lock<std::mutex> lock(windowMutex);
+                    windowFreed.wait(lock, [&] { return failed || inFlight < inFlightLimit; });
+                    if (failed) {
+                        break;
+                    }
+                }
+                Frame frame;
+                frame.index = index;
+                Clock::time_point began = Clock::now();
+                {
+                    TRACE_SCOPE("sequence.decode");
+                    if (!capture.read(frame.image) || frame.image.empty()) {
+                        break; //  
+                    }
+                }
+                stats.stageSeconds[SequenceStats::STAGE_DECODE] += elapsed(began);
+                {
+                    std::lock_guard<std::mutex> lock(windowMutex);
+                    inFlight++;
+                }
+                if (!decoded.push(std::move(frame))) {
+                    break;
+                }
+            }
+        }
+        catch (const std::exception& e) {
+            fail(e.what());
+        }
+        decoded.close();
+        });
+
+    std::vector<std::thread> workers;
+    std::vector<double> workerSeconds(workerCount, 0.0);
+    std::atomic<int> activeWorkers(workerCount);
+    for (int w = 0; w < workerCount; w++) {
+        workers.emplace_back([&, w] {
+            try {
+                Frame frame;
+                while (!failed && decoded.pop(frame)) {
+                    Clock::time_point began = Clock::now();
+                    {
+                        TRACE_SCOPE("sequence.process");
+                        frame.image = recipe.apply(frame.image, overlays);
+                    }
+                    workerSeconds[w] += elapsed(began);
+                    if (!processed.push(std::move(frame))) {
+                        break;
+                    }
+                }
+            }
+            catch (const std::exception& e) {
+                fail(e.what());
+            }
+            if (--activeWorkers == 0) {
+                processed.close(); //   :    
+            }
+            });
+    }
+
+    //    ; ,   ,   
+    try {
+        std::map<int, cv::Mat> waiting;
+        Frame frame;
+        while (!failed && processed.pop(frame)) {
+            waiting[frame.index] = frame.image;
+            for (auto next = waiting.find(stats.frames); next != waiting.end(); next = waiting.find(stats.frames)) {
+                Clock::time_point began = Clock::now();
+                {
+                    TRACE_SCOPE("sequence.encode");
+                    writer.write(next->second);
+                }
+                stats.stageSeconds[SequenceStats::STAGE_ENCODE] += elapsed(began);
+                waiting.erase(next);
+                stats.frames++;
+                {
+                    std::lock_guard<std::mutex> lock(windowMutex);
+                    inFlight--;
+                }
+                windowFreed.notify_one();
+                if (progress) {
+                    progress(stats.frames);
+                }
+            }
+        }
+    }
+    catch (const std::exception& e) {
+        fail(e.what());
+    }
+
+    decoder.join();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    if (!error.empty()) {
+        throw std::runtime_error(error);
+    }
+    for (double seconds : workerSeconds) {
+        stats.stageSeconds[SequenceStats::STAGE_PROCESS] += seconds;
+    }
+    stats.seconds = elapsed(start);
+    return stats;
+}
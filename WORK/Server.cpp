@@ -0,0 +1,425 @@
+//   :    Unix-,  
+//     .
+//
+//   work_server --socket /tmp/work.sock [--workers N] [--threads N] [--cache-mb 2048] [--trace FILE]
+//
+//  -   (. Recipe.h)      run  :
+//   source = photo.jpg
+//   filter = blur 5
+//   brightness = 1.2
+//   overlay = logo.png 0.5
+//   output = result.jpg   ( )
+//   quality = 90          ( JPEG/WebP,   95)
+//   palette = 5           (    5 ;   output)
+//   run
+//  -  : "ok <> ms [palette #rrggbb ...]"  "error <>".
+//  stats     .
+// : printf 'source = a.jpg\nsaturation = 0\noutput = b.jpg\nrun\n' | socat - UNIX-CONNECT:/tmp/work.sock
+//
+//  ,         ImageCache 
+//  --cache-mb;         .  
+//   --workers ,     --threads  .
+//     ( 0600).
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "BoundedQueue.h"
+#include "Export.h"
+#include "ImageCache.h"
+#include "Palette.h"
+#include "Pipeline.h"
+#include "Recipe.h"
+#include "TaskScheduler.h"
+#include "Trace.h"
+
+namespace {
+
+    struct ServerOptions {
+        std::string socketPath;
+        int workers = 4;
+        int threads = 0;
+        size_t cacheMegabytes = 2048;
+        std::string tracePath;
+    };
+
+    // :      
+    struct Job {
+        Recipe recipe;
+        std::string output;
+        int paletteColors = 0;
+        ExportSettings encoding;
+    };
+
+    const size_t MAX_REQUEST_BYTES = 1 << 20;
+
+    volatile std::sig_atomic_t stopRequested = 0;
+    int stopPipe[2] = { -1, -1 }; //     ,   poll
+
+    //      (, ),   
+    //       accept,     stopPipe
+    void requestStop(int) {
+        const int savedErrno = errno;
+        stopRequested = 1;
+        const char byte = 1;
+        if (write(stopPipe[1], &byte, 1) < 0) {
+            //   :     
+        }
+        errno = savedErrno;
+    }
+
+    void printUsage() {
+        std::cerr << "Usage: work_server --socket PATH [--workers N] [--threads N] [--cache-mb MB] [--trace FILE]\n";
+    }
+
+    bool parseArguments(int argc, char** argv, ServerOptions& options) {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            bool hasValue = i + 1 < argc;
+            if (arg == "--socket" && hasValue) options.socketPath = argv[++i];
+            else if (arg == "--workers" && hasValue) options.workers = std::max(1, std::stoi(argv[++i]));
+            else if (arg == "--threads" && hasValue) options.threads = std::stoi(argv[++i]);
+            else if (arg == "--cache-mb" && hasValue) options.cacheMegabytes = std::stoul(argv[++i]);
+            else if (arg == "--trace" && hasValue) options.tracePath = argv[++i];
+            else return false;
+        }
+        return !options.socketPath.empty();
+    }
+
+    //  output, quality  palette   ,  -  
+    Job parseJob(const std::string& text) {
+        Job job;
+        std::istringstream in(text);
+        std::stringstream recipeText;
+        std::string line;
+        while (std::getline(in, line)) {
+            size_t separator = line.find('=');
+            std::string key;
+            if (separator != std::string::npos) {
+                std::istringstream(line.substr(0, separator)) >> key;
+            }
+            std::istringstream value(separator != std::string::npos ? line.substr(separator + 1) : "");
+            if (key == "output") {
+                std::getline(value >> std::ws, job.output);
+                job.output.erase(job.output.find_last_not_of(" \t\r") + 1);
+            }
+            else if (key == "quality") {
+                if (!(value >> job.encoding.jpegQuality) || job.encoding.jpegQuality < 0 || job.encoding.jpegQuality > 100) {
+                    throw std::runtime_error("Invalid quality: " + line);
+                }
+            }
+            else if (key == "palette") {
+                if (!(value >> job.paletteColors) || job.paletteColors < 1) {
+                    throw std::runtime_error("Invalid palette size: " + line);
+                }
+            }
+            else {
+                recipeText << line << "\n";
+            }
+        }
+        job.recipe = Recipe::parse(recipeText);
+        if (job.recipe.source.empty()) {
+            throw std::runtime_error("Job needs source = FILE");
+        }
+        if (job.output.empty() && job.paletteColors == 0) {
+            throw std::runtime_error("Job needs output = FILE or palette = N");
+        }
+        return job;
+    }
+
+    //      .   ,  ,
+    //    ,  
+    cv::Mat render(const Job& job, ImageCache& cache) {
+        const Recipe& recipe = job.recipe;
+        std::vector<OverlayLayer> layers;
+        for (const Recipe::OverlaySpec& spec : recipe.overlays) {
+            OverlayLayer layer;
+            layer.image = *cache.overlay(spec.path);
+            layer.opacity = spec.opacity;
+            layer.placement = spec.placement;
+            layer.source = spec.path;
+            layers.push_back(layer);
+        }
+
+        if (!recipe.filters.empty()) {
+            std::shared_ptr<const cv::Mat> source = cache.image(recipe.source);
+            return recipe.apply(source->clone(), layers);
+        }
+
+        //        ;  
+        //     ,     
+        const double scale = recipe.params.scaleFactor;
+        cv::Mat rendered, result;
+        if (scale >= 1.0) {
+            std::shared_ptr<const cv::Mat> source = cache.image(recipe.source);
+            RenderPipeline::renderFullResolution(*source, layers, recipe.params, rendered);
+            if (scale == 1.0) {
+                return rendered;
+            }
+            cv::resize(rendered, result, cv::Size(), scale, scale, cv::INTER_LINEAR);
+            return result;
+        }
+        std::shared_ptr<const ProxyPyramid> pyramid = cache.pyramid(recipe.source);
+        const cv::Size full = pyramid->fullSize();
+        const cv::Size target(cv::saturate_cast<int>(full.width * scale), cv::saturate_cast<int>(full.height * scale));
+        RenderPipeline::renderFullResolution(pyramid->level(pyramid->levelFor(target)), layers, recipe.params, rendered);
+        if (rendered.size() == target) {
+            return rendered;
+        }
+        cv::resize(rendered, result, target, 0, 0, cv::INTER_AREA);
+        return result;
+    }
+
+    //  ;     
+    std::string runJob(const std::string& text, ImageCache& cache) {
+        TRACE_SCOPE("server.job");
+        auto start = std::chrono::steady_clock::now();
+        Job job = parseJob(text);
+        cv::Mat result = render(job, cache);
+
+        std::string reply;
+        if (!job.output.empty()) {
+            TRACE_SCOPE("server.encode");
+            std::string ext = job.output.substr(std::min(job.output.size(), job.output.find_last_of('.')));
+            std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+            if (!cv::imwrite(job.output, encodableImage(result, ext), encoderParams(ext, job.encoding))) {
+                throw std::runtime_error("Failed to write " + job.output);
+            }
+        }
+        if (job.paletteColors > 0) {
+            reply += " palette";
+            for (const cv::Vec3b& color : Palette::extractPalette(result, job.paletteColors)) {
+                char hex[8];
+                std::snprintf(hex, sizeof(hex), "#%02x%02x%02x", color[2], color[1], color[0]);
+                reply += std::string(" ") + hex;
+            }
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        char timing[32];
+        std::snprintf(timing, sizeof(timing), "ok %.1f ms", ms);
+        return timing + reply;
+    }
+
+    //     run, stats   
+    bool readRequest(int connection, std::string& request) {
+        char buffer[4096];
+        size_t lineStart = 0;
+        while (request.size() < MAX_REQUEST_BYTES) {
+            ssize_t received = recv(connection, buffer, sizeof(buffer), 0);
+            if (received < 0 && errno == EINTR) {
+                continue;
+            }
+            if (received <= 0) {
+                return received == 0 && !request.empty(); //     
+            }
+            request.append(buffer, static_cast<size_t>(received));
+            size_t end;
+            while ((end = request.find('\n', lineStart)) != std::string::npos) {
+                std::string line = request.substr(lineStart, end - lineStart);
+                line.erase(line.find_last_not_of(" \t\r") + 1);
+                if (line == "run" || (line == "stats" && lineStart == 0)) {
+                    request.erase(line == "run" ? lineStart : end + 1);
+                    return true;
+                }
+                lineStart = end + 1;
+            }
+        }
+        return false;
+    }
+
+    bool writeAll(int connection, const std::string& text) {
+        size_t sent = 0;
+        while (sent < text.size()) {
+            ssize_t written = send(connection, text.data() + sent, text.size() - sent, 0);
+            if (written < 0 && errno == EINTR) {
+                continue;
+            }
+            if (written <= 0) {
+                return false;
+            }
+            sent += static_cast<size_t>(written);
+        }
+        return true;
+    }
+
+    void serveConnection(int connection, ImageCache& cache) {
+        timeval timeout = { 30, 0 }; //       
+        setsockopt(connection, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+        std::string request;
+        std::string reply;
+        if (!readRequest(connection, request)) {
+            reply = "error incomplete request";
+        }
+        else if (request.compare(0, 5, "stats") == 0) {
+            ImageCache::Stats stats = cache.stats();
+            reply = "ok hits " + std::to_string(stats.hits) + " misses " + std::to_string(stats.misses) +
+                " entries " + std::to_string(stats.entries) + " bytes " + std::to_string(stats.bytes);
+        }
+        else {
+            try {
+                reply = runJob(request, cache);
+            }
+            catch (const std::exception& e) {
+                reply = std::string("error ") + e.what();
+                std::replace(reply.begin(), reply.end(), '\n', ' ');
+            }
+        }
+        writeAll(connection, reply + "\n");
+    }
+
+    // ,   .       ,
+    //      
+    int listenOn(const std::string& path) {
+        sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(address.sun_path)) {
+            throw std::runtime_error("Socket path is too long: " + path);
+        }
+        std::strcpy(address.sun_path, path.c_str());
+
+        struct stat info;
+        if (lstat(path.c_str(), &info) == 0) {
+            if (!S_ISSOCK(info.st_mode)) {
+                throw std::runtime_error("Not a socket: " + path);
+            }
+            int probe = socket(AF_UNIX, SOCK_STREAM, 0);
+            bool alive = probe >= 0 && connect(probe, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+            if (probe >= 0) {
+                close(probe);
+            }
+            if (alive) {
+                throw std::runtime_error("Another server is listening on " + path);
+            }
+            unlink(path.c_str());
+        }
+
+        int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listener < 0) {
+            throw std::runtime_error("Failed to create socket");
+        }
+        mode_t previous = umask(0077);
+        bool bound = bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+        umask(previous);
+        if (!bound || listen(listener, 64) != 0) {
+            close(listener);
+            throw std::runtime_error("Failed to listen on " + path + ": " + std::strerror(errno));
+        }
+        return listener;
+    }
+}
+
+int main(int argc, char** argv) {
+    ServerOptions options;
+    bool parsed = false;
+    try {
+        parsed = parseArguments(argc, argv, options);
+    }
+    catch (const std::exception&) {
+        parsed = false; //   
+    }
+    if (!parsed) {
+        printUsage();
+        return 2;
+    }
+
+    //      
+    if (pipe(stopPipe) != 0 || fcntl(stopPipe[1], F_SETFL, O_NONBLOCK) != 0) {
+        std::cerr << "pipe: " << std::strerror(errno) << "\n";
+        return 1;
+    }
+    std::signal(SIGPIPE, SIG_IGN); // ,   ,    
+    struct sigaction stop;
+    std::memset(&stop, 0, sizeof(stop));
+    stop.sa_handler = requestStop;
+    stop.sa_flags = SA_RESTART; //         
+    sigaction(SIGINT, &stop, nullptr);
+    sigaction(SIGTERM, &stop, nullptr);
+
+    if (!options.tracePath.empty()) {
+        Tracer::instance().startTrace(options.tracePath);
+    }
+    TaskScheduler::install(options.threads); //  cv::parallel_for_     
+
+    int listener;
+    try {
+        listener = listenOn(options.socketPath);
+    }
+    catch (const std::exception& e) {
+        std::cerr << e.what() << "\n";
+        return 1;
+    }
+
+    ImageCache cache(options.cacheMegabytes << 20);
+    BoundedQueue<int> connections(static_cast<size_t>(options.workers) * 4);
+    std::vector<std::thread> workers;
+    for (int i = 0; i < options.workers; i++) {
+        workers.emplace_back([&] {
+            int connection;
+            while (connections.pop(connection)) {
+                serveConnection(connection, cache);
+                close(connection);
+            }
+            });
+    }
+
+    std::cout << "Listening on " << options.socketPath << " (" << options.workers << " workers, "
+        << TaskScheduler::instance().threadCount() << " threads, " << options.cacheMegabytes << " MB cache)\n" << std::flush;
+    pollfd waits[2] = { { listener, POLLIN, 0 }, { stopPipe[0], POLLIN, 0 } };
+    while (!stopRequested) {
+        if (poll(waits, 2, -1) < 0) {
+            if (errno != EINTR) {
+                std::cerr << "poll: " << std::strerror(errno) << "\n";
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+            continue;
+        }
+        if (waits[1].revents != 0 || !(waits[0].revents & POLLIN)) {
+            continue; //  (   )     
+        }
+        int connection = accept(listener, nullptr, nullptr);
+        if (connection < 0) {
+            if (errno != EINTR) {
+                std::cerr << "accept: " << std::strerror(errno) << "\n";
+                std::this_thread::sleep_for(std::chrono::milliseconds(100)); // ,  
+            }
+            continue;
+        }
+        if (!connections.push(connection)) {
+            close(connection);
+        }
+    }
+
+    //   ,   
+    close(listener);
+    unlink(options.socketPath.c_str());
+    connections.close();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+    ImageCache::Stats stats = cache.stats();
+    std::cout << "Stopped: " << stats.hits << " cache hits, " << stats.misses << " misses\n";
+    if (!options.tracePath.empty()) {
+        Tracer::instance().printStats(std::cerr);
+        Tracer::instance().writeTrace();
+    }
+    return 0;
+}
@@ -0,0 +1,182 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include "ImageLoader.h"
+#include "PixelFormat.h"
+#include "ProxyPyramid.h"
+#include "Recipe.h"
+#include "Trace.h"
+
+//       (    ).
+//      : ,      
+//  ,    .    ,   
+//     .
+//       (, ,  )   ;
+//    ,   .
+class ProxyCache {
+public:
+    static uint64_t key(const Recipe& recipe) {
+        uint64_t hash = 14695981039346656037ull; // FNV-1a
+        auto mix = [&hash](const void* data, size_t size) {
+            const unsigned char* bytes = static_cast<const unsigned char*>(data);
+            for (size_t i = 0; i < size; i++) {
+                hash = (hash ^ bytes[i]) * 1099511628211ull;
+            }
+        };
+        mix(recipe.source.data(), recipe.source.size());
+        int64_t stamp[2] = { -1, -1 }; //      
+#ifdef _WIN32
+        struct _stat64 info;
+        if (_stat64(recipe.source.c_str(), &info) == 0) {
+#else
+        struct stat info;
+        if (stat(recipe.source.c_str(), &info) == 0) {
+#endif
+            stamp[0] = static_cast<int64_t>(info.st_size);
+            stamp[1] = static_cast<int64_t>(info.st_mtime);
+        }
+        mix(stamp, sizeof(stamp));
+        for (const std::string& spec : recipe.filters) {
+            mix(spec.c_str(), spec.size() + 1);
+        }
+        return hash;
+    }
+
+    //   image;   ,       
+    static void write(const std::string& path, uint64_t key, const cv::Mat& image) {
+        TRACE_SCOPE("session.write_cache");
+        ProxyPyramid pyramid;
+        pyramid.build(image);
+
+        Header header = {};
+        std::memcpy(header.magic, MAGIC, sizeof(header.magic));
+        header.key = key;
+        header.levels = static_cast<uint32_t>(pyramid.size());
+        std::vector<Level> table(pyramid.size());
+        uint64_t offset = align(sizeof(Header) + table.size() * sizeof(Level));
+        for (int i = 0; i < pyramid.size(); i++) {
+            const cv::Mat& level = pyramid.level(i);
+            table[i].rows = level.rows;
+            table[i].cols = level.cols;
+            table[i].type = level.type();
+            table[i].step = static_cast<uint64_t>(level.cols) * level.elemSize();
+            table[i].offset = offset;
+            offset = align(offset + table[i].step * level.rows);
+        }
+
+        std::string temporary = path + ".tmp";
+        {
+            std::ofstream file(temporary, std::ios::binary);
+            file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+            file.write(reinterpret_cast<const char*>(table.data()), table.size() * sizeof(Level));
+            uint64_t position = sizeof(Header) + table.size() * sizeof(Level);
+            const std::vector<char> padding(PAGE, 0);
+            for (int i = 0; i < pyramid.size(); i++) {
+                file.write(padding.data(), static_cast<std::streamsize>(table[i].offset - position));
+                const cv::Mat& level = pyramid.level(i);
+                for (int y = 0; y < level.rows; y++) {
+                    file.write(reinterpret_cast<const char*>(level.ptr(y)), static_cast<std::streamsize>(table[i].step));
+                }
+                position = table[i].offset + table[i].step * level.rows;
+            }
+            if (!file) {
+                std::remove(temporary.c_str());
+                throw std::runtime_error("Failed to write session cache: " + path);
+            }
+        }
+        std::remove(path.c_str());
+        if (std::rename(temporary.c_str(), path.c_str()) != 0) {
+            std::remove(temporary.c_str());
+            throw std::runtime_error("Failed to write session cache: " + path);
+        }
+    }
+
+    // false -  ,          
+    bool open(const std::string& path, uint64_t key) {
+        file.reset();
+        levels.clear();
+        std::shared_ptr<MappedFile> mapped;
+        try {
+            mapped = std::make_shared<MappedFile>(path);
+        }
+        catch (const std::exception&) {
+            return false;
+        }
+        Header header;
+        if (mapped->size() < sizeof(Header)) {
+            return false;
+        }
+        std::memcpy(&header, mapped->data(), sizeof(header));
+        if (std::memcmp(header.magic, MAGIC, sizeof(header.magic)) != 0 || header.key != key || header.levels == 0 ||
+            sizeof(Header) + static_cast<uint64_t>(header.levels) * sizeof(Level) > mapped->size()) {
+            return false;
+        }
+        std::vector<Level> table(header.levels);
+        std::memcpy(table.data(), mapped->data() + sizeof(Header), table.size() * sizeof(Level));
+        for (const Level& level : table) {
+            //   ,      
+            if (level.rows <= 0 || level.cols <= 0 || !isSupportedImageType(level.type) ||
+                level.step < static_cast<uint64_t>(level.cols) * CV_ELEM_SIZE(level.type) ||
+                level.offset > mapped->size() || level.step > (mapped->size() - level.offset) / level.rows) {
+                return false;
+            }
+        }
+        file = mapped;
+        levels = table;
+        return true;
+    }
+
+    int levelCount() const { return static_cast<int>(levels.size()); }
+    cv::Size levelSize(int level) const { return cv::Size(levels[level].cols, levels[level].rows); }
+
+    //     target ( target -  )
+    int levelFor(const cv::Size& target) const {
+        int index = 0;
+        for (int i = 1; i < levelCount() && target.width > 0 && target.height > 0; i++) {
+            if (levels[i].cols < target.width || levels[i].rows < target.height) {
+                break;
+            }
+            index = i;
+        }
+        return index;
+    }
+
+    //  ;     ,      
+    cv::Mat readLevel(int level) const {
+        TRACE_SCOPE("session.read_cache");
+        const Level& info = levels[level];
+        cv::Mat mapped(info.rows, info.cols, info.type, const_cast<uchar*>(file->data() + info.offset), static_cast<size_t>(info.step));
+        return mapped.clone();
+    }
+
+private:
+    enum { PAGE = 4096 };
+    static constexpr const char* MAGIC = "WRKPRXY1";
+
+    struct Header {
+        char magic[8];
+        uint64_t key;
+        uint32_t levels;
+        uint32_t reserved;
+    };
+
+    struct Level {
+        int32_t rows, cols, type, reserved;
+        uint64_t offset, step;
+    };
+
+    static uint64_t align(uint64_t offset) {
+        return (offset + PAGE - 1) / PAGE * PAGE;
+    }
+
+    std::shared_ptr<MappedFile> file; //   ,     
+    std::vector<Level> levels;
+};
@@ -1,15 +1,35 @@
+#ifndef NOMINMAX
+#define NOMINMAX // windows.h     std::min/std::max
+#endif
 #include <opencv2/opencv.hpp>
 #include <FL/Fl.H>
 #include <FL/Fl_Window.H>
+#include <FL/Fl_Double_Window.H>
 #include <FL/Fl_Button.H>
+#include <FL/Fl_Check_Button.H>
 #include <FL/Fl_Slider.H>
+#include <FL/Fl_Value_Slider.H>
 #include <windows.h>
 #include <commdlg.h>
 #include <memory>
 #include <string>
 #include <iostream>
 #include <stack>
+#include "Export.h"
 #include "Filters.h"
+#include "Pipeline.h"
+#include "PixelFormat.h"
+#include "History.h"
+#include "RenderWorker.h"
+#include "Palette.h"
+#include "HistogramView.h"
+#include "ImageView.h"
+#include "ImageLoader.h"
+#include "Session.h"
+#include "Statistics.h"
+#include "TaskScheduler.h"
+#include "Trace.h"
+#include <functional>
 
 
 //       
@@ -30,8 +50,9 @@ std::wstring openFileDialog(const wchar_t* filter) {
 }
 
 //       
-std::wstring saveFileDialog(const wchar_t* filter) {
-    wchar_t fileName[MAX_PATH] = L"output.jpg";
+std::wstring saveFileDialog(const wchar_t* filter, const wchar_t* defaultName = L"output.jpg") {
+    wchar_t fileName[MAX_PATH] = { 0 };
+    wcsncpy_s(fileName, defaultName, _TRUNCATE);
     OPENFILENAME ofn = { 0 };
     ofn.lStructSize = sizeof(OPENFILENAME);
     ofn.hwndOwner = NULL;
@@ -50,92 +71,284 @@ std::wstring saveFileDialog(const wchar_t* filter) {
 //     
 class ImageEditor {
 private:
-        //      
-    void saveState() {
-        history.push(image.clone()); //    
-    }
     cv::Mat image;
-    std::stack<cv::Mat> history; //     
-    double brightness = 1.0; //  
-    double saturation = 1.0; //  
-    double scaleFactor = 1.0; //  
-    int r = 0, g = 0, b = 0; //  RGB    
-    cv::Mat overlayImage; //    
-    double transparency = 1.0; //   
-
-    //   
+    std::string sourcePath; //   
+    std::vector<std::string> operations; //      (. Filter::spec)
+    UndoHistory history; //    
+    AdjustmentParams params; //   
+    std::vector<OverlayLayer> overlays; // ,   
+    std::function<void(const AdjustmentParams&)> paramsListener; //     
+    int paletteSize = 5; //    
+    BufferPool buffers; //      ,    
+    RenderWorker renderWorker; //   
+    ImageView* preview = nullptr; //  ,    
+    HistogramView* histogramView = nullptr; //   
+    StatisticsEngine statistics; //     
+    ImageLoader loader; //  :   ,    
+    ExportSettings exportSettings; //  JPEG    
+    ImageExporter exporter; //   
+    std::string windowTitle; //     
+
+    //   :     
     void updateImageDisplay() {
-        if (!image.empty() && image.channels() == 3) {
-            cv::Mat temp = image.clone();
-            applyBrightnessAndSaturation(temp);
-            applyRGBChannels(temp);
-
-            if (!overlayImage.empty()) {
-                cv::Mat overlayResized;
-                cv::resize(overlayImage, overlayResized, temp.size());
-                cv::addWeighted(temp, 1.0, overlayResized, transparency, 0, temp); //    
-            }
-
-            cv::resize(temp, temp, cv::Size(), scaleFactor, scaleFactor); //  
-            cv::imshow("Image", temp); //    OpenCV
-            cv::waitKey(1);  //  
+        if (!image.empty() && isSupportedImageType(image.type())) {
+            renderWorker.requestRender(params);
         }
         else {
             MessageBox(NULL, L"Invalid image format", L"Error", MB_OK | MB_ICONERROR);
         }
     }
 
+    //    ( FLTK   )
+    static void frameReadyCallback(void* data) {
+        ImageEditor* editor = static_cast<ImageEditor*>(data);
+        cv::Mat frame;
+        ImageStatistics frameStatistics;
+        if (editor->renderWorker.takeFrame(frame, &frameStatistics) && editor->preview) {
+            editor->preview->setFrame(frame);
+            if (editor->histogramView) {
+                editor->histogramView->setStatistics(frameStatistics);
+            }
+        }
+    }
 
-    //    
-    void applyBrightnessAndSaturation(cv::Mat& img) {
-        img.convertTo(img, -1, brightness, 0);
+    //      ( FLTK   )
+    static void fullImageLoadedCallback(void* data) {
+        ImageEditor* editor = static_cast<ImageEditor*>(data);
+        cv::Mat full;
+        std::string error;
+        if (!editor->loader.takeFull(full, error)) {
+            return;
+        }
+        if (full.empty()) {
+            MessageBox(NULL, std::wstring(L"Failed to load image: " + std::wstring(error.begin(), error.end())).c_str(), L"Error", MB_OK | MB_ICONERROR);
+            return;
+        }
+        editor->image = full;
+        editor->statistics.reset();
+        editor->renderWorker.setSource(editor->image);
+        editor->updateImageDisplay();
+    }
 
-        cv::Mat hsvImage;
-        cv::cvtColor(img, hsvImage, cv::COLOR_BGR2HSV);
-        for (int y = 0; y < hsvImage.rows; y++) {
-            for (int x = 0; x < hsvImage.cols; x++) {
-                cv::Vec3b& pixel = hsvImage.at<cv::Vec3b>(y, x);
-                pixel[1] = cv::saturate_cast<uchar>(pixel[1] * saturation);
+    //      ( FLTK   )
+    static void exportUpdateCallback(void* data) {
+        ImageEditor* editor = static_cast<ImageEditor*>(data);
+        Fl_Window* window = editor->preview ? editor->preview->window() : nullptr;
+        std::string error;
+        if (editor->exporter.takeResult(error)) {
+            if (window) {
+                window->copy_label(editor->windowTitle.c_str());
             }
+            if (!error.empty()) {
+                MessageBox(NULL, std::wstring(L"Failed to save image: " + std::wstring(error.begin(), error.end())).c_str(), L"Error", MB_OK | MB_ICONERROR);
+            }
+        }
+        else if (window && editor->exporter.busy()) {
+            window->copy_label((editor->windowTitle + " - saving " + std::to_string(editor->exporter.progress()) + "%").c_str());
         }
-        cv::cvtColor(hsvImage, img, cv::COLOR_HSV2BGR);
     }
 
-    //      RGB
-    void applyRGBChannels(cv::Mat& img) {
-        if (r != 0 || g != 0 || b != 0) {
-            cv::Mat channels[3];
-            cv::split(img, channels);
-            channels[0] += r; // R-
-            channels[1] += g; // G-
-            channels[2] += b; // B-
-            cv::merge(channels, 3, img);
+    //    ,     
+    bool checkLoaded() const {
+        if (loader.pending()) {
+            MessageBox(NULL, L"Image is still loading", L"Error", MB_OK | MB_ICONERROR);
+            return false;
         }
+        return true;
     }
 
 public:
+    //      RGB    
+    ImageEditor()
+        : renderWorker([this] { Fl::awake(frameReadyCallback, this); }, true, &buffers),
+        loader([this] { Fl::awake(fullImageLoadedCallback, this); }),
+        exporter([this] { Fl::awake(exportUpdateCallback, this); }) {}
+
+    ~ImageEditor() {
+        if (Tracer::instance().enabled()) {
+            buffers.printStats(std::cout);
+        }
+    }
+
+    void setHistogramView(HistogramView* view) {
+        histogramView = view;
+    }
+
+    //   :     ,
+    //     
+    void setPreview(ImageView* view) {
+        preview = view;
+        renderWorker.setViewportSize(cv::Size(view->w(), view->h()));
+        view->setResizeCallback([this](int width, int height) {
+            renderWorker.setViewportSize(cv::Size(width, height));
+            if (!image.empty()) {
+                renderWorker.requestRender(params);
+            }
+            });
+        view->setPanCallback([this](int dx, int dy) {
+            if (!image.empty()) {
+                renderWorker.panBy(cv::Point(dx, dy));
+                renderWorker.requestRender(params);
+            }
+            });
+    }
+
+    //       ,    
     cv::Mat getCurrentImage() const {
-        return image.clone();
+        return image;
+    }
+
+    int getPaletteSize() const { return paletteSize; }
+    void setPaletteSize(int value) { paletteSize = value; }
+    int getRed() const { return params.r; }
+    int getGreen() const { return params.g; }
+    int getBlue() const { return params.b; }
+
+    void setParamsListener(std::function<void(const AdjustmentParams&)> listener) {
+        paramsListener = listener;
+    }
+
+    //    
+    void setUndoMemoryBudget(size_t bytes) {
+        history.setMemoryBudget(bytes);
     }
-    int getRed() const { return r; }
-    int getGreen() const { return g; }
-    int getBlue() const { return b; }
     //  
+    //    JPEG,   8   ,  
+    //  ,   
     void openImage(const std::wstring& path) {
-        image = cv::imread(cv::String(path.begin(), path.end()), cv::IMREAD_COLOR);
-        if (image.empty()) {
+        cv::Mat preview;
+        cv::Size fullSize;
+        try {
+            preview = loader.open(cv::String(path.begin(), path.end()), 8, fullSize);
+        }
+        catch (const std::exception&) {
+            preview.release();
+        }
+        if (preview.empty()) {
             MessageBox(NULL, L"Failed to load image", L"Error", MB_OK | MB_ICONERROR);
         }
         else {
-            saveState(); //     
+            image = preview;
+            statistics.reset();
+            sourcePath = cv::String(path.begin(), path.end());
+            operations.clear();
+            history.clear(); //     
+            renderWorker.setSource(image, fullSize);
             updateImageDisplay();
         }
     }
 
-    //  
+    //   :  ,    (  ).
+    //         work_batch --recipe
+    Recipe currentRecipe() const {
+        Recipe recipe;
+        recipe.source = sourcePath;
+        recipe.filters = operations;
+        recipe.params = params;
+        for (const OverlayLayer& layer : overlays) {
+            Recipe::OverlaySpec spec;
+            spec.path = layer.source;
+            spec.opacity = layer.opacity;
+            spec.placement = layer.placement;
+            recipe.overlays.push_back(spec);
+        }
+        return recipe;
+    }
+
+    //  :   path      (path + ".cache")
+    void saveSession(const std::wstring& path) {
+        if (image.empty()) {
+            MessageBox(NULL, L"No image to save", L"Error", MB_OK | MB_ICONERROR);
+            return;
+        }
+        if (!checkLoaded()) {
+            return;
+        }
+        try {
+            std::string sessionPath(path.begin(), path.end());
+            Recipe recipe = currentRecipe();
+            recipe.save(sessionPath);
+            ProxyCache::write(sessionPath + ".cache", ProxyCache::key(recipe), image);
+        }
+        catch (const std::exception& e) {
+            MessageBox(NULL, std::wstring(L"Failed to save session: " + std::wstring(e.what(), e.what() + strlen(e.what()))).c_str(), L"Error", MB_OK | MB_ICONERROR);
+        }
+    }
+
+    //  .            , 
+    //      ,        .
+    //        ,    
+    void openSession(const std::wstring& path) {
+        try {
+            std::string sessionPath(path.begin(), path.end());
+            Recipe recipe = Recipe::load(sessionPath);
+            if (recipe.source.empty()) {
+                throw std::runtime_error("Session has no source image");
+            }
+            std::vector<OverlayLayer> layers = recipe.loadOverlays();
+            uint64_t key = ProxyCache::key(recipe);
+
+            ProxyCache cache;
+            cv::Mat first; //  
+            cv::Size fullSize;
+            if (cache.open(sessionPath + ".cache", key)) {
+                cv::Size viewport = preview ? cv::Size(preview->w(), preview->h()) : cv::Size();
+                first = cache.readLevel(cache.levelFor(viewport));
+                fullSize = cache.levelSize(0);
+                loader.loadInBackground([cache] { return cache.readLevel(0); });
+            }
+            else {
+                TRACE_SCOPE("session.rebuild");
+                loader.cancel();
+                first = decodeImageFile(recipe.source);
+                if (first.empty()) {
+                    throw std::runtime_error("Failed to load image: " + recipe.source);
+                }
+                for (std::unique_ptr<Filter>& filter : recipe.createFilters()) {
+                    filter->apply(first, buffers); //  ,   ,    
+                }
+                fullSize = first.size();
+                ProxyCache::write(sessionPath + ".cache", key, first);
+            }
+
+            image = first;
+            statistics.reset();
+            sourcePath = recipe.source;
+            operations = recipe.filters;
+            params = recipe.params;
+            overlays = layers;
+            history.clear();
+            renderWorker.setOverlays(overlays);
+            renderWorker.setSource(image, fullSize);
+            if (paramsListener) {
+                paramsListener(params);
+            }
+            updateImageDisplay();
+        }
+        catch (const std::exception& e) {
+            MessageBox(NULL, std::wstring(L"Failed to open session: " + std::wstring(e.what(), e.what() + strlen(e.what()))).c_str(), L"Error", MB_OK | MB_ICONERROR);
+        }
+    }
+
+    const ExportSettings& getExportSettings() const { return exportSettings; }
+    void setExportSettings(const ExportSettings& value) { exportSettings = value; }
+
+    //        .    ,
+    //     ;    ,   
+    //     
     void saveImage(const std::wstring& path) {
+        if (!image.empty() && !checkLoaded()) {
+            return;
+        }
+        if (exporter.busy()) {
+            MessageBox(NULL, L"Previous image is still being saved", L"Error", MB_OK | MB_ICONERROR);
+            return;
+        }
         if (!image.empty()) {
-            cv::imwrite(cv::String(path.begin(), path.end()), image);
+            if (preview && preview->window() && windowTitle.empty()) {
+                windowTitle = preview->window()->label();
+            }
+            exporter.start(std::string(path.begin(), path.end()), image, overlays, params, exportSettings);
         }
         else {
             MessageBox(NULL, L"No image to save", L"Error", MB_OK | MB_ICONERROR);
@@ -144,13 +357,28 @@ public:
 
     //  
     void applyFilter(std::unique_ptr<Filter> filter) {
+        if (!image.empty() && !checkLoaded()) {
+            return;
+        }
         if (!image.empty() && filter) {
+            cv::Mat previous = image;
             try {
-                saveState(); //     
-                filter->apply(image);
+                {
+                    TRACE_SCOPE("editor.clone");
+                    image = buffers.acquire(previous.size(), previous.type());
+                    previous.copyTo(image); //    ,     
+                }
+                {
+                    ScopedTimer timer(filter->name());
+                    filter->apply(image, buffers);
+                }
+                statistics.update(image, history.recordPixels(previous, image)); //   
+                operations.push_back(filter->spec());
+                renderWorker.setSource(image);
                 updateImageDisplay();
             }
             catch (const std::exception& e) {
+                image = previous;
                 MessageBox(NULL, std::wstring(L"Filter error: " + std::wstring(e.what(), e.what() + strlen(e.what()))).c_str(), L"Error", MB_OK | MB_ICONERROR);
             }
         }
@@ -159,32 +387,65 @@ public:
         }
     }
 
+    //     ;    ( "levels"  )
+    void autoLevels() {
+        if (!image.empty() && !checkLoaded()) {
+            return;
+        }
+        if (image.empty()) {
+            MessageBox(NULL, L"No image to apply filter", L"Error", MB_OK | MB_ICONERROR);
+            return;
+        }
+        applyFilter(::autoLevels(statistics.statistics(image)));
+    }
+
+    //  :  ,     
+    void endAdjustment() {
+        history.breakMerge();
+    }
+
     //  
     void setBrightness(double value) {
-        saveState(); //     
-        brightness = value;
+        history.recordParams(UndoHistory::PARAM_BRIGHTNESS, params);
+        params.brightness = value;
         updateImageDisplay();
     }
 
     //  
     void setSaturation(double value) {
-        saveState(); //     
-        saturation = value;
+        history.recordParams(UndoHistory::PARAM_SATURATION, params);
+        params.saturation = value;
         updateImageDisplay();
     }
 
     //  
     void setScale(double value) {
-        saveState(); //     
-        scaleFactor = value;
+        history.recordParams(UndoHistory::PARAM_SCALE, params);
+        params.scaleFactor = value;
         updateImageDisplay(); //      
     }
 
     //   
     void undo() {
         if (!history.empty()) {
-            image = history.top(); //   
-            history.pop(); //    
+            std::vector<OverlayLayer> restored = overlays;
+            std::vector<cv::Rect> changed;
+            if (history.undo(image, params, restored, &changed)) {
+                statistics.update(image, changed);
+                renderWorker.setSource(image); //  
+                if (!operations.empty()) {
+                    operations.pop_back();
+                }
+            }
+            else {
+                if (!sameLayers(restored, overlays)) {
+                    overlays = restored;
+                    renderWorker.setOverlays(overlays);
+                }
+                if (paramsListener) {
+                    paramsListener(params);
+                }
+            }
             updateImageDisplay();
         }
         else {
@@ -194,19 +455,25 @@ public:
 
     //    RGB 
     void setRGB(int red, int green, int blue) {
-        saveState();
-        r = red;
-        g = green;
-        b = blue;
+        UndoHistory::Param channel = red != params.r ? UndoHistory::PARAM_RED
+            : green != params.g ? UndoHistory::PARAM_GREEN : UndoHistory::PARAM_BLUE;
+        history.recordParams(channel, params);
+        params.r = red;
+        params.g = green;
+        params.b = blue;
         updateImageDisplay();
     }
 
-    //   
+    //     ( PNG )
     void addOverlayImage(const std::wstring& path, double alpha) {
-        cv::Mat overlay = cv::imread(cv::String(path.begin(), path.end()), cv::IMREAD_COLOR);
-        if (!overlay.empty()) {
-            overlayImage = overlay;
-            transparency = alpha;
+        OverlayLayer layer;
+        layer.source = cv::String(path.begin(), path.end());
+        layer.image = loadOverlayImage(layer.source);
+        layer.opacity = alpha;
+        if (!layer.image.empty()) {
+            history.recordParams(UndoHistory::PARAM_OVERLAY, params, overlays);
+            overlays.push_back(layer);
+            renderWorker.setOverlays(overlays);
             updateImageDisplay();
         }
         else {
@@ -216,36 +483,6 @@ public:
 };
 
 
-//     
-class Palette {
-public:
-    static std::vector<cv::Vec3b> extractPalette(const cv::Mat& image, int numColors) {
-        if (image.empty() || image.channels() != 3) {
-            throw std::runtime_error("Invalid image for palette extraction");
-        }
-
-        cv::Mat data;
-        image.convertTo(data, CV_32F); //       
-        data = data.reshape(1, image.rows * image.cols); //     
-
-        //    k-means
-        cv::Mat labels, centers;
-        cv::kmeans(data, numColors, labels,
-            cv::TermCriteria(cv::TermCriteria::EPS + cv::TermCriteria::MAX_ITER, 10, 1.0),
-            3, cv::KMEANS_PP_CENTERS, centers);
-
-        centers.convertTo(centers, CV_8UC1); //      
-        centers = centers.reshape(3); //     
-
-        //      
-        std::vector<cv::Vec3b> palette;
-        for (int i = 0; i < centers.rows; ++i) {
-            palette.push_back(centers.at<cv::Vec3b>(i, 0));
-        }
-        return palette;
-    }
-};
-
 //     
 void displayPalette(const std::vector<cv::Vec3b>& palette) {
     const int swatchSize = 50;
@@ -265,8 +502,7 @@ void extractPaletteCallback(Fl_Widget*, void* data) {
     ImageEditor* editor = static_cast<ImageEditor*>(data);
 
     try {
-        const int numColors = 5; //    
-        auto palette = Palette::extractPalette(editor->getCurrentImage(), numColors);
+        auto palette = Palette::extractPalette(editor->getCurrentImage(), editor->getPaletteSize());
         displayPalette(palette);
     }
     catch (const std::exception& e) {
@@ -292,12 +528,33 @@ void openImageCallback(Fl_Widget*, void* data) {
 
 void saveImageCallback(Fl_Widget*, void* data) {
     ImageEditor* editor = static_cast<ImageEditor*>(data);
-    std::wstring path = saveFileDialog(L"JPEG Files (*.jpg)\0*.jpg\0PNG Files (*.png)\0*.png\0");
+    std::wstring path = saveFileDialog(L"JPEG Files (*.jpg)\0*.jpg\0PNG Files (*.png)\0*.png\0PPM Files, low memory (*.ppm)\0*.ppm\0");
     if (!path.empty()) {
         editor->saveImage(path);
     }
 }
 
+void openSessionCallback(Fl_Widget*, void* data) {
+    ImageEditor* editor = static_cast<ImageEditor*>(data);
+    std::wstring path = openFileDialog(L"Sessions (*.wsession)\0*.wsession\0");
+    if (!path.empty()) {
+        editor->openSession(path);
+    }
+}
+
+void saveSessionCallback(Fl_Widget*, void* data) {
+    ImageEditor* editor = static_cast<ImageEditor*>(data);
+    std::wstring path = saveFileDialog(L"Sessions (*.wsession)\0*.wsession\0", L"session.wsession");
+    if (!path.empty()) {
+        editor->saveSession(path);
+    }
+}
+
+void autoLevelsCallback(Fl_Widget*, void* data) {
+    ImageEditor* editor = static_cast<ImageEditor*>(data);
+    editor->autoLevels();
+}
+
 void applyGrayscaleCallback(Fl_Widget*, void* data) {
     ImageEditor* editor = static_cast<ImageEditor*>(data);
     editor->applyFilter(std::make_unique<GrayscaleFilter>());
@@ -336,11 +593,22 @@ public:
         openButton->callback(openImageCallback, editor);
 
         Fl_Button* saveButton = new Fl_Button(x + w + 10, y, w, h, "Save");
+        //     (. exportImage)    PPM
+        saveButton->tooltip("PPM is written strip by strip. JPEG and PNG need a full-size copy of the adjusted image.");
         saveButton->callback(saveImageCallback, editor);
 
         Fl_Button* undoButton = new Fl_Button(x + 2 * (w + 10), y, w, h, "Undo");
         undoButton->callback(undoCallback, editor);
 
+        Fl_Button* openSessionButton = new Fl_Button(x + 3 * (w + 10), y, w, h, "Open Session");
+        openSessionButton->callback(openSessionCallback, editor);
+
+        Fl_Button* saveSessionButton = new Fl_Button(x + 4 * (w + 10), y, w, h, "Save Session");
+        saveSessionButton->callback(saveSessionCallback, editor);
+
+        Fl_Button* autoLevelsButton = new Fl_Button(x + 5 * (w + 10), y, w, h, "Auto Levels");
+        autoLevelsButton->callback(autoLevelsCallback, editor);
+
         Fl_Button* grayscaleButton = new Fl_Button(x, y + h + 10, w, h, "Grayscale");
         grayscaleButton->callback(applyGrayscaleCallback, editor);
 
@@ -368,10 +636,66 @@ public:
 
         Fl_Button* paletteButton = new Fl_Button(x, parent->h() - h - 10, w, h, "Extract Palette");
         paletteButton->callback(extractPaletteCallback, editor);
+
+        Fl_Value_Slider* paletteSizeSlider = new Fl_Value_Slider(x + w + 10, parent->h() - h - 10, 2 * w, h, "Colors");
+        paletteSizeSlider->type(FL_HORIZONTAL);
+        paletteSizeSlider->align(FL_ALIGN_RIGHT);
+        paletteSizeSlider->bounds(1, 16);
+        paletteSizeSlider->step(1);
+        paletteSizeSlider->value(editor->getPaletteSize());
+        paletteSizeSlider->callback([](Fl_Widget* widget, void* data) {
+            ImageEditor* editor = static_cast<ImageEditor*>(data);
+            editor->setPaletteSize(static_cast<int>(static_cast<Fl_Value_Slider*>(widget)->value()));
+            }, editor);
+
+        Fl_Value_Slider* qualitySlider = new Fl_Value_Slider(x + 3 * (w + 10) + 60, parent->h() - h - 10, w, h, "Quality");
+        qualitySlider->type(FL_HORIZONTAL);
+        qualitySlider->align(FL_ALIGN_RIGHT);
+        qualitySlider->bounds(10, 100);
+        qualitySlider->step(1);
+        qualitySlider->value(editor->getExportSettings().jpegQuality);
+        qualitySlider->callback([](Fl_Widget* widget, void* data) {
+            ImageEditor* editor = static_cast<ImageEditor*>(data);
+            ExportSettings settings = editor->getExportSettings();
+            settings.jpegQuality = static_cast<int>(static_cast<Fl_Value_Slider*>(widget)->value());
+            editor->setExportSettings(settings);
+            }, editor);
+
+        Fl_Check_Button* progressiveButton = new Fl_Check_Button(x + 5 * (w + 10), parent->h() - h - 10, w, h, "Progressive");
+        progressiveButton->value(editor->getExportSettings().progressive ? 1 : 0);
+        progressiveButton->callback([](Fl_Widget* widget, void* data) {
+            ImageEditor* editor = static_cast<ImageEditor*>(data);
+            ExportSettings settings = editor->getExportSettings();
+            settings.progressive = static_cast<Fl_Check_Button*>(widget)->value() != 0;
+            editor->setExportSettings(settings);
+            }, editor);
+
+        Fl_Value_Slider* compressionSlider = new Fl_Value_Slider(x + 6 * (w + 10), parent->h() - h - 10, w, h, "PNG level");
+        compressionSlider->type(FL_HORIZONTAL);
+        compressionSlider->align(FL_ALIGN_RIGHT);
+        compressionSlider->bounds(0, 9);
+        compressionSlider->step(1);
+        compressionSlider->value(editor->getExportSettings().pngCompression);
+        compressionSlider->tooltip("PNG compression: higher gives smaller files but saves slower");
+        compressionSlider->callback([](Fl_Widget* widget, void* data) {
+            ImageEditor* editor = static_cast<ImageEditor*>(data);
+            ExportSettings settings = editor->getExportSettings();
+            settings.pngCompression = static_cast<int>(static_cast<Fl_Value_Slider*>(widget)->value());
+            editor->setExportSettings(settings);
+            }, editor);
     }
 };
 
 class SliderPanel {
+    // Callback     :      
+    static bool releasedSlider(ImageEditor* editor) {
+        if (Fl::event() != FL_RELEASE) {
+            return false;
+        }
+        editor->endAdjustment();
+        return true;
+    }
+
 public:
     SliderPanel(Fl_Window* parent, int x, int y, int w, int h, ImageEditor* editor) {
         int spacing = 30; // Adjusted spacing between sliders
@@ -381,8 +705,12 @@ public:
         brightnessSlider->minimum(0.0);
         brightnessSlider->maximum(2.0);
         brightnessSlider->value(1.0);
+        brightnessSlider->when(FL_WHEN_CHANGED | FL_WHEN_RELEASE_ALWAYS);
         brightnessSlider->callback([](Fl_Widget* widget, void* data) {
             ImageEditor* editor = static_cast<ImageEditor*>(data);
+            if (releasedSlider(editor)) {
+                return;
+            }
             editor->setBrightness(static_cast<Fl_Slider*>(widget)->value());
             }, editor);
 
@@ -391,8 +719,12 @@ public:
         saturationSlider->minimum(0.0);
         saturationSlider->maximum(2.0);
         saturationSlider->value(1.0);
+        saturationSlider->when(FL_WHEN_CHANGED | FL_WHEN_RELEASE_ALWAYS);
         saturationSlider->callback([](Fl_Widget* widget, void* data) {
             ImageEditor* editor = static_cast<ImageEditor*>(data);
+            if (releasedSlider(editor)) {
+                return;
+            }
             editor->setSaturation(static_cast<Fl_Slider*>(widget)->value());
             }, editor);
 
@@ -401,8 +733,12 @@ public:
         scaleSlider->minimum(0.1);
         scaleSlider->maximum(3.0);
         scaleSlider->value(1.0);
+        scaleSlider->when(FL_WHEN_CHANGED | FL_WHEN_RELEASE_ALWAYS);
         scaleSlider->callback([](Fl_Widget* widget, void* data) {
             ImageEditor* editor = static_cast<ImageEditor*>(data);
+            if (releasedSlider(editor)) {
+                return;
+            }
             editor->setScale(static_cast<Fl_Slider*>(widget)->value());
             }, editor);
 
@@ -411,8 +747,12 @@ public:
         redSlider->minimum(-255);
         redSlider->maximum(255);
         redSlider->value(0);
+        redSlider->when(FL_WHEN_CHANGED | FL_WHEN_RELEASE_ALWAYS);
         redSlider->callback([](Fl_Widget* widget, void* data) {
             ImageEditor* editor = static_cast<ImageEditor*>(data);
+            if (releasedSlider(editor)) {
+                return;
+            }
             int red = static_cast<Fl_Slider*>(widget)->value();
             int green = editor->getGreen();
             int blue = editor->getBlue();
@@ -424,8 +764,12 @@ public:
         greenSlider->minimum(-255);
         greenSlider->maximum(255);
         greenSlider->value(0);
+        greenSlider->when(FL_WHEN_CHANGED | FL_WHEN_RELEASE_ALWAYS);
         greenSlider->callback([](Fl_Widget* widget, void* data) {
             ImageEditor* editor = static_cast<ImageEditor*>(data);
+            if (releasedSlider(editor)) {
+                return;
+            }
             int red = editor->getRed();
             int green = static_cast<Fl_Slider*>(widget)->value();
             int blue = editor->getBlue();
@@ -437,32 +781,55 @@ public:
         blueSlider->minimum(-255);
         blueSlider->maximum(255);
         blueSlider->value(0);
+        blueSlider->when(FL_WHEN_CHANGED | FL_WHEN_RELEASE_ALWAYS);
         blueSlider->callback([](Fl_Widget* widget, void* data) {
             ImageEditor* editor = static_cast<ImageEditor*>(data);
+            if (releasedSlider(editor)) {
+                return;
+            }
             int red = editor->getRed();
             int green = editor->getGreen();
             int blue = static_cast<Fl_Slider*>(widget)->value();
             editor->setRGB(red, green, blue);
             }, editor);
+
+        //    ,  
+        editor->setParamsListener([=](const AdjustmentParams& params) {
+            brightnessSlider->value(params.brightness);
+            saturationSlider->value(params.saturation);
+            scaleSlider->value(params.scaleFactor);
+            redSlider->value(params.r);
+            greenSlider->value(params.g);
+            blueSlider->value(params.b);
+            });
     }
 };
 
 class MainWindow {
 public:
     MainWindow() {
-        Fl_Window* window = new Fl_Window(800, 400, "Image Editor");
+        Fl_Double_Window* window = new Fl_Double_Window(1400, 720, "Image Editor");
         ImageEditor editor;
 
         ButtonPanel buttonPanel(window, 10, 10, 120, 30, &editor);
         SliderPanel sliderPanel(window, 10, 90, 760, 20, &editor);
 
+        ImageView* preview = new ImageView(800, 10, 590, 700);
+        editor.setPreview(preview);
+        window->resizable(preview);
+
+        HistogramView* histogram = new HistogramView(10, 400, 760, 230);
+        editor.setHistogramView(histogram);
+
         window->end();
         window->show();
+        Fl::lock(); //   :    Fl::awake
         Fl::run();
     }
 };
 
 int main() {
+    TaskScheduler::install(); // ,   cv::parallel_for_    
     MainWindow mainWindow;
     return 0;
 }
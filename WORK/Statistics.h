@@ -0,0 +1,234 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <opencv2/core/hal/intrin.hpp>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+#include "Filters.h"
+#include "PixelFormat.h"
+#include "Trace.h"
+
+//       8- BGR; ,      
+struct ImageStatistics {
+    enum Channel { CHANNEL_B, CHANNEL_G, CHANNEL_R, CHANNEL_LUMA, CHANNEL_COUNT };
+
+    uint64_t histogram[CHANNEL_COUNT][256] = {};
+    uint64_t pixels = 0;
+
+    int minimum(int channel) const {
+        for (int v = 0; v < 256; v++) {
+            if (histogram[channel][v] > 0) {
+                return v;
+            }
+        }
+        return 0;
+    }
+
+    int maximum(int channel) const {
+        for (int v = 255; v >= 0; v--) {
+            if (histogram[channel][v] > 0) {
+                return v;
+            }
+        }
+        return 0;
+    }
+
+    double mean(int channel) const {
+        uint64_t sum = 0;
+        for (int v = 0; v < 256; v++) {
+            sum += histogram[channel][v] * v;
+        }
+        return pixels ? static_cast<double>(sum) / pixels : 0.0;
+    }
+
+    //  ,      fraction  
+    int percentile(int channel, double fraction) const {
+        const uint64_t target = static_cast<uint64_t>(fraction * pixels);
+        uint64_t sum = 0;
+        for (int v = 0; v < 256; v++) {
+            sum += histogram[channel][v];
+            if (sum > target) {
+                return v;
+            }
+        }
+        return 255;
+    }
+};
+
+namespace statistics_kernel {
+    //   BT.601   ,    256
+    enum { WEIGHT_B = 29, WEIGHT_G = 150, WEIGHT_R = 77 };
+
+    //    width   counts[][]; luma -    width .
+    // weightFirst  weightLast -       (  RGB   )
+    inline void accumulateRow(const uchar* row, int width, uint32_t (*counts)[256], uchar* luma,
+        int weightFirst = WEIGHT_B, int weightLast = WEIGHT_R) {
+        int x = 0;
+#if CV_SIMD
+        //   ,    
+        const int lanes = cv::v_uint8::nlanes;
+        const cv::v_uint16 first = cv::vx_setall_u16(static_cast<ushort>(weightFirst));
+        const cv::v_uint16 green = cv::vx_setall_u16(WEIGHT_G);
+        const cv::v_uint16 last = cv::vx_setall_u16(static_cast<ushort>(weightLast));
+        const cv::v_uint16 half = cv::vx_setall_u16(128);
+        for (; x <= width - lanes; x += lanes) {
+            cv::v_uint8 c0, c1, c2;
+            cv::v_load_deinterleave(row + 3 * x, c0, c1, c2);
+            cv::v_uint16 a0, a1, b0, b1, d0, d1;
+            cv::v_expand(c0, a0, a1);
+            cv::v_expand(c1, b0, b1);
+            cv::v_expand(c2, d0, d1);
+            //   255 * 256 + 128,  16  
+            cv::v_uint16 y0 = (a0 * first + b0 * green + d0 * last + half) >> 8;
+            cv::v_uint16 y1 = (a1 * first + b1 * green + d1 * last + half) >> 8;
+            cv::v_store(luma + x, cv::v_pack(y0, y1));
+        }
+        cv::vx_cleanup();
+#endif
+        for (; x < width; x++) {
+            const uchar* pixel = row + 3 * x;
+            luma[x] = static_cast<uchar>((pixel[0] * weightFirst + pixel[1] * WEIGHT_G + pixel[2] * weightLast + 128) >> 8);
+        }
+        for (x = 0; x < width; x++) {
+            counts[0][row[3 * x]]++;
+            counts[1][row[3 * x + 1]]++;
+            counts[2][row[3 * x + 2]]++;
+            counts[3][luma[x]]++;
+        }
+    }
+}
+
+//    .
+//      ,  -  .     ,
+//    ,       .
+//   ;       .
+class StatisticsEngine {
+public:
+    // rgbOrder -    RGB ( );     B, G, R
+    explicit StatisticsEngine(int tileSize = 256, bool rgbOrder = false) : tileSize(tileSize), rgbOrder(rgbOrder) {}
+
+    //  :      
+    void reset() {
+        tiles.clear();
+        imageSize = cv::Size();
+    }
+
+    //      changed (,    )
+    void update(const cv::Mat& image, const std::vector<cv::Rect>& changed) {
+        if (tiles.empty() || image.size() != imageSize) {
+            reset();
+            return;
+        }
+        TRACE_SCOPE("statistics.update");
+        std::vector<char> marked(tiles.size(), 0);
+        std::vector<int> dirty;
+        for (const cv::Rect& rect : changed) {
+            cv::Rect area = rect & cv::Rect(cv::Point(), imageSize);
+            if (area.empty()) {
+                continue;
+            }
+            for (int ty = area.y / tileSize; ty <= (area.y + area.height - 1) / tileSize; ty++) {
+                for (int tx = area.x / tileSize; tx <= (area.x + area.width - 1) / tileSize; tx++) {
+                    int index = ty * columns + tx;
+                    if (!marked[index]) {
+                        marked[index] = 1;
+                        dirty.push_back(index);
+                    }
+                }
+            }
+        }
+        recompute(image, dirty);
+    }
+
+    //  image;   ,  .
+    //     ,     (8- BGR)
+    const ImageStatistics& statistics(const cv::Mat& image) {
+        CV_Assert(isSupportedImageType(image.type()));
+        if (tiles.empty() || image.size() != imageSize) {
+            TRACE_SCOPE("statistics.full");
+            imageSize = image.size();
+            columns = (imageSize.width + tileSize - 1) / tileSize;
+            int rows = (imageSize.height + tileSize - 1) / tileSize;
+            tiles.assign(static_cast<size_t>(columns) * rows, Tile());
+            total = ImageStatistics();
+            total.pixels = static_cast<uint64_t>(imageSize.area());
+            std::vector<int> all(tiles.size());
+            for (size_t i = 0; i < all.size(); i++) {
+                all[i] = static_cast<int>(i);
+            }
+            recompute(image, all);
+        }
+        return total;
+    }
+
+    //       ( )
+    static ImageStatistics measure(const cv::Mat& image, bool rgbOrder = false) {
+        StatisticsEngine engine(256, rgbOrder);
+        return engine.statistics(image);
+    }
+
+private:
+    struct Tile {
+        uint32_t counts[ImageStatistics::CHANNEL_COUNT][256];
+        Tile() { std::memset(counts, 0, sizeof(counts)); }
+    };
+
+    cv::Rect tileRect(int index) const {
+        cv::Rect rect((index % columns) * tileSize, (index / columns) * tileSize, tileSize, tileSize);
+        return rect & cv::Rect(cv::Point(), imageSize);
+    }
+
+    //   dirty         
+    void recompute(const cv::Mat& image, const std::vector<int>& dirty) {
+        std::vector<Tile> fresh(dirty.size());
+        const int weightFirst = rgbOrder ? statistics_kernel::WEIGHT_R : statistics_kernel::WEIGHT_B;
+        const int weightLast = rgbOrder ? statistics_kernel::WEIGHT_B : statistics_kernel::WEIGHT_R;
+        cv::parallel_for_(cv::Range(0, static_cast<int>(dirty.size())), [&](const cv::Range& range) {
+            std::vector<uchar> luma(tileSize);
+            cv::Mat expanded; // ,   8- BGR
+            for (int i = range.start; i < range.end; i++) {
+                cv::Mat tile = image(tileRect(dirty[i]));
+                if (tile.type() != CV_8UC3) {
+                    expandToBgr8(tile, expanded);
+                    tile = expanded;
+                }
+                for (int y = 0; y < tile.rows; y++) {
+                    statistics_kernel::accumulateRow(tile.ptr<uchar>(y), tile.cols, fresh[i].counts,
+                        luma.data(), weightFirst, weightLast);
+                }
+            }
+            });
+        //      B, G, R
+        const int order[ImageStatistics::CHANNEL_COUNT] = { rgbOrder ? 2 : 0, 1, rgbOrder ? 0 : 2, 3 };
+        for (size_t i = 0; i < dirty.size(); i++) {
+            Tile& previous = tiles[dirty[i]];
+            for (int c = 0; c < ImageStatistics::CHANNEL_COUNT; c++) {
+                uint64_t* histogram = total.histogram[order[c]];
+                for (int v = 0; v < 256; v++) {
+                    histogram[v] = histogram[v] + fresh[i].counts[c][v] - previous.counts[c][v];
+                }
+            }
+            previous = fresh[i];
+        }
+    }
+
+    int tileSize;
+    bool rgbOrder;
+    cv::Size imageSize;
+    int columns = 0;
+    std::vector<Tile> tiles;
+    ImageStatistics total;
+};
+
+// :    ,   clip     
+//    0  255;   ,     
+inline std::unique_ptr<LevelsFilter> autoLevels(const ImageStatistics& statistics, double clip = 0.005) {
+    cv::Vec3b low, high;
+    for (int c = 0; c < 3; c++) {
+        low[c] = static_cast<uchar>(statistics.percentile(c, clip));
+        high[c] = static_cast<uchar>(statistics.percentile(c, 1.0 - clip));
+    }
+    return std::make_unique<LevelsFilter>(low, high);
+}
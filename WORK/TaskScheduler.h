@@ -0,0 +1,390 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#if CV_VERSION_MAJOR > 4 || (CV_VERSION_MAJOR == 4 && CV_VERSION_MINOR >= 6)
+#include <opencv2/core/parallel/parallel_backend.hpp>
+#define WORK_OPENCV_PARALLEL_BACKEND 1
+#endif
+
+//      (work stealing).
+//      : ,   ,     
+//    ( -   ),        .
+//        .
+//  install()     cv::parallel_for_,      OpenCV,
+//    (   )    .
+class TaskScheduler {
+public:
+    typedef std::function<void()> Task;
+
+    // threads -   , 0 -   
+    explicit TaskScheduler(int threads = 0) {
+        start(threads);
+    }
+
+    ~TaskScheduler() {
+        stop();
+    }
+
+    TaskScheduler(const TaskScheduler&) = delete;
+    TaskScheduler& operator=(const TaskScheduler&) = delete;
+
+    static TaskScheduler& instance() {
+        static TaskScheduler scheduler;
+        return scheduler;
+    }
+
+    //        cv::parallel_for_   OpenCV
+    static void install(int threads = 0) {
+        TaskScheduler& scheduler = instance();
+        if (threads > 0 && threads != scheduler.threadCount()) {
+            scheduler.setThreadCount(threads);
+        }
+#ifdef WORK_OPENCV_PARALLEL_BACKEND
+        cv::parallel::setParallelForBackend(std::make_shared<OpenCVBackend>(), false);
+#else
+        cv::setNumThreads(scheduler.threadCount()); //  OpenCV:  OpenCV   
+#endif
+    }
+
+    int threadCount() const { return static_cast<int>(workers.size()); }
+
+    //   ; ,    ,    
+    void setThreadCount(int threads) {
+        CV_Assert(current().scheduler != this);
+        stop();
+        start(threads);
+    }
+
+    //    ; 0   
+    int workerIndex() const {
+        return current().scheduler == this ? current().index : 0;
+    }
+
+    void submit(Task task) {
+        const int self = current().scheduler == this ? current().index : -1;
+        WorkQueue& queue = self >= 0 ? *queues[self] : injected;
+        {
+            std::lock_guard<std::mutex> lock(queue.mutex);
+            queue.tasks.push_back(std::move(task));
+        }
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            queued++;
+        }
+        wake.notify_one();
+    }
+
+    //       :  ,  .
+    //       :     
+    //    (,   )  .
+    bool runPending(bool takeInjected = false) {
+        const int self = current().scheduler == this ? current().index : -1;
+        Task task;
+        if (self >= 0 && popBack(*queues[self], task)) {
+            execute(task);
+            return true;
+        }
+        if (takeInjected && popFront(injected, task)) {
+            execute(task);
+            return true;
+        }
+        const int count = static_cast<int>(queues.size());
+        for (int i = 1; i <= count; i++) {
+            int victim = ((self < 0 ? 0 : self) + i) % count;
+            if (victim != self && popFront(*queues[victim], task)) {
+                execute(task);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    //   body   range;      .
+    // parts -  , 0 -       
+    void parallelFor(const cv::Range& range, const std::function<void(const cv::Range&)>& body, int parts = 0);
+
+private:
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    struct ThreadState {
+        TaskScheduler* scheduler = nullptr;
+        int index = 0;
+    };
+
+    static ThreadState& current() {
+        thread_local ThreadState state;
+        return state;
+    }
+
+#ifdef WORK_OPENCV_PARALLEL_BACKEND
+    // cv::parallel_for_   
+    class OpenCVBackend : public cv::parallel::ParallelForAPI {
+    public:
+        void parallel_for(int tasks, FN_parallel_for_body_cb_t body, void* data) override {
+            TaskScheduler::instance().parallelFor(cv::Range(0, tasks), [&](const cv::Range& range) {
+                body(range.start, range.end, data);
+                });
+        }
+        int getThreadNum() const override { return TaskScheduler::instance().workerIndex(); }
+        int getNumThreads() const override { return TaskScheduler::instance().threadCount(); }
+        int setNumThreads(int threads) override {
+            int previous = getNumThreads();
+            //   cv::setNumThreads: 0 - ,  0 -   
+            TaskScheduler::instance().setThreadCount(threads == 0 ? 1 : std::max(0, threads));
+            return previous;
+        }
+        const char* getName() const override { return "work_tasks"; }
+    };
+#endif
+
+    void start(int threads) {
+        if (threads <= 0) {
+            threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+        }
+        stopping = false;
+        for (int i = 0; i < threads; i++) {
+            queues.push_back(std::make_unique<WorkQueue>());
+        }
+        for (int i = 0; i < threads; i++) {
+            workers.emplace_back([this, i] { run(i); });
+        }
+    }
+
+    void stop() {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            stopping = true;
+        }
+        wake.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+        workers.clear();
+        queues.clear();
+    }
+
+    void run(int index) {
+        current().scheduler = this;
+        current().index = index;
+        while (true) {
+            if (runPending(true)) {
+                continue;
+            }
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            wake.wait(lock, [this] { return stopping || queued > 0; });
+            if (stopping) {
+                return;
+            }
+        }
+    }
+
+    bool popBack(WorkQueue& queue, Task& task) {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) {
+            return false;
+        }
+        task = std::move(queue.tasks.back());
+        queue.tasks.pop_back();
+        return true;
+    }
+
+    bool popFront(WorkQueue& queue, Task& task) {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) {
+            return false;
+        }
+        task = std::move(queue.tasks.front());
+        queue.tasks.pop_front();
+        return true;
+    }
+
+    void execute(Task& task) {
+        {
+            std::lock_guard<std::mutex> lock(sleepMutex);
+            queued--;
+        }
+        task();
+    }
+
+    std::vector<std::unique_ptr<WorkQueue>> queues; //     
+    WorkQueue injected;                             //     
+    std::vector<std::thread> workers;
+    std::mutex sleepMutex;
+    std::condition_variable wake;
+    int queued = 0; //    
+    bool stopping = false;
+};
+
+//      .
+//     ,      , 
+//     .       wait().
+class TaskGroup {
+public:
+    explicit TaskGroup(TaskScheduler& scheduler = TaskScheduler::instance()) : scheduler(scheduler) {}
+
+    ~TaskGroup() {
+        try {
+            wait();
+        }
+        catch (...) {
+        }
+    }
+
+    TaskGroup(const TaskGroup&) = delete;
+    TaskGroup& operator=(const TaskGroup&) = delete;
+
+    void run(TaskScheduler::Task task) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            pending++;
+        }
+        scheduler.submit([this, task] {
+            try {
+                task();
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--pending == 0) {
+                done.notify_all();
+            }
+            });
+    }
+
+    void wait() {
+        while (true) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (pending == 0) {
+                    break;
+                }
+            }
+            if (!scheduler.runPending()) {
+                //     ;  ,
+                //       ,   
+                std::unique_lock<std::mutex> lock(mutex);
+                done.wait_for(lock, std::chrono::microseconds(200), [this] { return pending == 0; });
+            }
+        }
+        std::exception_ptr failure;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            std::swap(failure, error);
+        }
+        if (failure) {
+            std::rethrow_exception(failure);
+        }
+    }
+
+private:
+    TaskScheduler& scheduler;
+    std::mutex mutex;
+    std::condition_variable done;
+    int pending = 0;
+    std::exception_ptr error;
+};
+
+inline void TaskScheduler::parallelFor(const cv::Range& range, const std::function<void(const cv::Range&)>& body, int parts) {
+    const int length = range.end - range.start;
+    if (parts <= 0) {
+        parts = threadCount() * 4;
+    }
+    parts = std::min(parts, length);
+    if (parts <= 1 || threadCount() <= 1) {
+        if (length > 0) {
+            body(range);
+        }
+        return;
+    }
+    TaskGroup group(*this);
+    for (int i = 1; i < parts; i++) {
+        cv::Range part(range.start + static_cast<int>(static_cast<long long>(length) * i / parts),
+            range.start + static_cast<int>(static_cast<long long>(length) * (i + 1) / parts));
+        group.run([&body, part] { body(part); });
+    }
+    body(cv::Range(range.start, range.start + length / parts));
+    group.wait();
+}
+
+//  :  ,    ,    .
+//   (,     )  .
+class TaskGraph {
+public:
+    //  ; dependencies -    .   
+    int add(TaskScheduler::Task task, const std::vector<int>& dependencies = std::vector<int>()) {
+        Node node;
+        node.task = std::move(task);
+        node.dependencies = static_cast<int>(dependencies.size());
+        int index = static_cast<int>(nodes.size());
+        for (int dependency : dependencies) {
+            CV_Assert(dependency >= 0 && dependency < index);
+            nodes[dependency].successors.push_back(index);
+        }
+        nodes.push_back(std::move(node));
+        return index;
+    }
+
+    size_t size() const { return nodes.size(); }
+
+    //      .    ,   
+    //     (   -  ), 
+    //   run()
+    void run(TaskScheduler& scheduler = TaskScheduler::instance()) {
+        std::unique_ptr<std::atomic<int>[]> remaining(new std::atomic<int>[nodes.size()]);
+        for (size_t i = 0; i < nodes.size(); i++) {
+            remaining[i] = nodes[i].dependencies;
+        }
+        TaskGroup group(scheduler);
+        std::function<void(int)> launch = [&](int index) {
+            group.run([&, index] {
+                std::exception_ptr failure;
+                try {
+                    nodes[index].task();
+                }
+                catch (...) {
+                    failure = std::current_exception();
+                }
+                for (int successor : nodes[index].successors) {
+                    if (--remaining[successor] == 0) {
+                        launch(successor);
+                    }
+                }
+                if (failure) {
+                    std::rethrow_exception(failure);
+                }
+                });
+        };
+        for (size_t i = 0; i < nodes.size(); i++) {
+            if (nodes[i].dependencies == 0) {
+                launch(static_cast<int>(i));
+            }
+        }
+        group.wait();
+    }
+
+private:
+    struct Node {
+        TaskScheduler::Task task;
+        int dependencies = 0;
+        std::vector<int> successors;
+    };
+
+    std::vector<Node> nodes;
+};
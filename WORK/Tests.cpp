@@ -0,0 +1,344 @@
+//      ( ).
+//
+//   work_tests [...]
+//
+//     ,   .   1, 
+//     . CMake      CTest.
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "Convolution.h"
+#include "FilterChain.h"
+#include "History.h"
+#include "ImageCache.h"
+#include "Recipe.h"
+#include "TaskScheduler.h"
+
+namespace {
+
+    void check(bool condition, const std::string& message) {
+        if (!condition) {
+            throw std::runtime_error(message);
+        }
+    }
+
+    //       ( )
+    double maxDifference(const cv::Mat& a, const cv::Mat& b) {
+        check(a.size() == b.size() && a.type() == b.type(), "image size or type differs");
+        return cv::norm(a, b, cv::NORM_INF);
+    }
+
+    //    :   ,   
+    cv::Mat makeImage(cv::Size size, unsigned seed) {
+        cv::Mat image(size, CV_8UC3);
+        cv::RNG rng(seed);
+        rng.fill(image, cv::RNG::UNIFORM, 0, 256);
+        cv::GaussianBlur(image, image, cv::Size(5, 5), 0);
+        cv::rectangle(image, cv::Rect(size.width / 4, size.height / 4, size.width / 3, size.height / 3), cv::Scalar(250, 10, 128), cv::FILLED);
+        return image;
+    }
+
+    //      ,   apply()  
+    void testFilterChainFusion() {
+        const std::vector<std::string> specs = { "levels 10 20 30 240 230 220", "invert", "mirror", "blur 3", "mirror", "sharpen", "mirror" };
+        const ColorAdjustment adjustment(1.1, 1.3, 12, -7, 20);
+        const cv::Mat source = makeImage(cv::Size(301, 157), 1);
+
+        cv::Mat sequential = source.clone();
+        for (const std::string& spec : specs) {
+            createFilter(spec)->apply(sequential);
+        }
+        ColorAdjustmentFilter(adjustment).apply(sequential);
+
+        std::vector<std::unique_ptr<Filter>> filters;
+        for (const std::string& spec : specs) {
+            filters.push_back(createFilter(spec));
+        }
+        filters.push_back(std::make_unique<ColorAdjustmentFilter>(adjustment));
+        cv::Mat fused = source.clone();
+        FilterChain(std::move(filters)).apply(fused);
+
+        //     float      
+        check(maxDifference(sequential, fused) <= 1, "fused chain differs from sequential apply()");
+    }
+
+    //          
+    void testUndoHistory() {
+        UndoHistory history;
+        AdjustmentParams params;
+        std::vector<OverlayLayer> overlays;
+
+        const cv::Mat before = makeImage(cv::Size(600, 300), 2);
+        cv::Mat image = before.clone();
+        cv::rectangle(image, cv::Rect(270, 10, 40, 200), cv::Scalar(1, 2, 3), cv::FILLED);
+        std::vector<cv::Rect> changed = history.recordPixels(before, image);
+        check(!changed.empty() && changed.size() < 6, "pixel delta should keep only the changed tiles");
+
+        //  Invert    XOR,      
+        const cv::Mat beforeInvert = image.clone();
+        cv::Mat inverted, restored;
+        cv::bitwise_not(image, inverted);
+        history.recordPixels(image, inverted);
+        const size_t afterFirstInvert = history.memoryUsage();
+        cv::bitwise_not(inverted, restored);
+        history.recordPixels(inverted, restored);
+        check(history.memoryUsage() == afterFirstInvert, "identical tiles should be stored once");
+        image = restored;
+
+        //     -   
+        history.recordParams(UndoHistory::PARAM_BRIGHTNESS, params);
+        params.brightness = 1.1;
+        history.recordParams(UndoHistory::PARAM_BRIGHTNESS, params);
+        params.brightness = 1.2;
+        history.breakMerge();
+        history.recordParams(UndoHistory::PARAM_BRIGHTNESS, params);
+        params.brightness = 1.5;
+
+        //    -  
+        OverlayLayer layer;
+        layer.image = cv::Mat(8, 8, CV_8UC4, cv::Scalar::all(255));
+        history.recordParams(UndoHistory::PARAM_OVERLAY, params, overlays);
+        overlays.push_back(layer);
+        history.recordParams(UndoHistory::PARAM_OVERLAY, params, overlays);
+        overlays.push_back(layer);
+
+        check(!history.undo(image, params, overlays) && overlays.size() == 1, "undo should remove only the last overlay");
+        check(!history.undo(image, params, overlays) && overlays.empty(), "undo should remove the first overlay");
+        check(!history.undo(image, params, overlays) && params.brightness == 1.2, "undo should restore the end of the first drag");
+        check(!history.undo(image, params, overlays) && params.brightness == 1.0, "undo should restore the value before the first drag");
+        check(history.undo(image, params, overlays) && maxDifference(image, inverted) == 0, "undo should restore the inverted image");
+        check(history.memoryUsage() == afterFirstInvert, "undo should keep tiles still used by the first invert");
+        check(history.undo(image, params, overlays) && maxDifference(image, beforeInvert) == 0, "undo should revert the first invert");
+        check(history.undo(image, params, overlays), "last undo should restore pixels");
+        check(maxDifference(image, before) == 0, "undone pixels differ from the original");
+        check(history.empty(), "history should be empty");
+    }
+
+    // write()  parse()    ;     - 
+    void testRecipeRoundTrip() {
+        Recipe recipe;
+        recipe.source = "photos/a b.jpg";
+        recipe.filters = { "blur 20", "levels 10 20 30 240 230 220", "kernel 3 1 0.25 0.5 0.25", "mirror" };
+        recipe.params.brightness = 1.0 / 3.0;
+        recipe.params.saturation = 0.7;
+        recipe.params.r = -12;
+        recipe.params.g = 5;
+        recipe.params.b = 255;
+        recipe.params.scaleFactor = 0.45;
+        recipe.params.transparency = 0.8;
+        Recipe::OverlaySpec overlay;
+        overlay.path = "C:\\Users\\First Last\\logo 2.png"; //    Windows  
+        overlay.opacity = 0.5;
+        overlay.placement = cv::Rect2d(0.7, 0.1, 0.25, 0.2);
+        recipe.overlays.push_back(overlay);
+
+        std::stringstream text;
+        recipe.write(text);
+        Recipe parsed = Recipe::parse(text);
+        check(parsed.source == recipe.source, "source changed");
+        check(parsed.filters == recipe.filters, "filters changed");
+        check(parsed.params.brightness == recipe.params.brightness && parsed.params.saturation == recipe.params.saturation &&
+            parsed.params.r == recipe.params.r && parsed.params.g == recipe.params.g && parsed.params.b == recipe.params.b &&
+            parsed.params.scaleFactor == recipe.params.scaleFactor && parsed.params.transparency == recipe.params.transparency,
+            "adjustment parameters changed");
+        check(parsed.overlays.size() == 1 && parsed.overlays[0].path == overlay.path && parsed.overlays[0].opacity == overlay.opacity &&
+            parsed.overlays[0].placement == overlay.placement, "overlay changed");
+        std::istringstream unquoted("overlay = logo.png 0.5\n"); // ,   
+        Recipe old = Recipe::parse(unquoted);
+        check(old.overlays.size() == 1 && old.overlays[0].path == "logo.png" && old.overlays[0].opacity == 0.5, "unquoted overlay path not read");
+
+        for (const char* bad : { "blur 60 junk", "mirror 2", "levels 1 2 3 4 5 6 7" }) {
+            bool rejected = false;
+            try {
+                createFilter(bad);
+            }
+            catch (const std::runtime_error&) {
+                rejected = true;
+            }
+            check(rejected, std::string("filter spec should be rejected: ") + bad);
+        }
+    }
+
+    //      cv::filter2D
+    void testConvolutionStrategies() {
+        const cv::Mat source = makeImage(cv::Size(333, 211), 3);
+        cv::RNG rng(4);
+        std::vector<cv::Mat> kernels;
+        cv::Mat random(7, 9, CV_32F); //  ,   
+        rng.fill(random, cv::RNG::UNIFORM, -0.2, 1.0);
+        kernels.push_back(random / cv::sum(random)[0]);
+        cv::Mat gaussian = cv::getGaussianKernel(15, 3.0, CV_32F);
+        kernels.push_back(gaussian * gaussian.t()); //  1
+        cv::Mat box = cv::Mat::ones(5, 5, CV_32F) / 25.0;
+        kernels.push_back(box);
+
+        const ConvolutionStrategy strategies[] = { CONVOLUTION_AUTO, CONVOLUTION_DIRECT, CONVOLUTION_SEPARABLE, CONVOLUTION_FFT };
+        for (const cv::Mat& kernel : kernels) {
+            cv::Mat expected;
+            cv::filter2D(source, expected, -1, kernel);
+            for (ConvolutionStrategy strategy : strategies) {
+                ConvolutionFilter filter(kernel, strategy);
+                cv::Mat result = source.clone();
+                filter.apply(result);
+                //   float          
+                std::ostringstream message;
+                message << filter.name() << " differs from filter2D for a " << kernel.cols << "x" << kernel.rows << " kernel";
+                check(maxDifference(result, expected) <= 1, message.str());
+            }
+        }
+    }
+
+    //        ;     run()
+    void testTaskGraphOrdering() {
+        TaskScheduler scheduler(4);
+        for (int round = 0; round < 20; round++) {
+            const int layers = 6, width = 8;
+            TaskGraph graph;
+            std::vector<std::vector<int>> dependencies;
+            std::unique_ptr<std::atomic<int>[]> finished(new std::atomic<int>[layers * width]);
+            std::atomic<int> clock(0);
+            std::atomic<bool> ordered(true);
+            for (int layer = 0; layer < layers; layer++) {
+                for (int i = 0; i < width; i++) {
+                    std::vector<int> inputs;
+                    if (layer > 0) {
+                        inputs.push_back((layer - 1) * width + i);
+                        inputs.push_back((layer - 1) * width + (i * 3 + round) % width);
+                    }
+                    const int index = static_cast<int>(dependencies.size());
+                    finished[index] = -1;
+                    dependencies.push_back(inputs);
+                    graph.add([&, index] {
+                        for (int input : dependencies[index]) {
+                            if (finished[input] < 0) {
+                                ordered = false;
+                            }
+                        }
+                        finished[index] = clock++;
+                        }, inputs);
+                }
+            }
+            graph.run(scheduler);
+            check(ordered, "a node ran before one of its dependencies");
+            for (int i = 0; i < layers * width; i++) {
+                check(finished[i] >= 0, "a node did not run");
+            }
+        }
+
+        TaskGraph failing;
+        std::atomic<bool> successorRan(false);
+        int first = failing.add([] { throw std::runtime_error("node failed"); });
+        failing.add([&] { successorRan = true; }, { first });
+        bool propagated = false;
+        try {
+            failing.run(scheduler);
+        }
+        catch (const std::runtime_error&) {
+            propagated = true;
+        }
+        check(propagated, "node exception was not propagated from run()");
+        check(successorRan, "successor of a failed node did not run");
+    }
+
+    //     ,    
+    struct TemporaryImages {
+        std::vector<std::string> paths;
+
+        std::string write(const cv::Mat& image) {
+            std::string path = cv::tempfile(".png");
+            check(cv::imwrite(path, image), "failed to write " + path);
+            paths.push_back(path);
+            return path;
+        }
+
+        ~TemporaryImages() {
+            for (const std::string& path : paths) {
+                std::remove(path.c_str());
+            }
+        }
+    };
+
+    //      ,    
+    //    
+    void testImageCacheEviction() {
+        TemporaryImages files;
+        const size_t imageBytes = 100 * 100 * 3;
+        std::string a = files.write(makeImage(cv::Size(100, 100), 5));
+        std::string b = files.write(makeImage(cv::Size(100, 100), 6));
+        std::string c = files.write(makeImage(cv::Size(100, 100), 7));
+
+        ImageCache cache(2 * imageBytes + imageBytes / 2);
+        cache.image(a);
+        cache.image(b);
+        cache.image(a); // a   
+        check(cache.stats().hits == 1 && cache.stats().misses == 2, "second lookup of a should be a hit");
+        cache.image(c); //  b
+        ImageCache::Stats stats = cache.stats();
+        check(stats.entries == 2 && stats.bytes == 2 * imageBytes, "cache should hold two images");
+        cache.image(a);
+        check(cache.stats().hits == 2, "a should have survived eviction");
+        cache.image(b);
+        check(cache.stats().misses == 4, "b should have been evicted");
+        check(cache.stats().bytes <= 2 * imageBytes + imageBytes / 2, "cache exceeds its budget");
+
+        cv::Mat larger = makeImage(cv::Size(120, 100), 8);
+        check(cv::imwrite(a, larger), "failed to rewrite " + a);
+        std::shared_ptr<const cv::Mat> reloaded = cache.image(a);
+        check(reloaded->size() == larger.size(), "changed file was not decoded again");
+
+        //    0 ,     
+        ImageCache pyramids(4 * imageBytes);
+        pyramids.pyramid(c);
+        check(pyramids.stats().bytes == 2 * imageBytes, "pyramid level 0 should be counted");
+    }
+
+    struct TestCase {
+        const char* name;
+        std::function<void()> run;
+    };
+
+    const std::vector<TestCase>& testCases() {
+        static const std::vector<TestCase> cases = {
+            { "filter_chain", testFilterChainFusion },
+            { "undo_history", testUndoHistory },
+            { "recipe", testRecipeRoundTrip },
+            { "convolution", testConvolutionStrategies },
+            { "task_graph", testTaskGraphOrdering },
+            { "image_cache", testImageCacheEviction },
+        };
+        return cases;
+    }
+}
+
+int main(int argc, char** argv) {
+    std::vector<std::string> selected(argv + 1, argv + argc);
+    int failed = 0;
+    int run = 0;
+    for (const TestCase& test : testCases()) {
+        if (!selected.empty() && std::find(selected.begin(), selected.end(), test.name) == selected.end()) {
+            continue;
+        }
+        run++;
+        try {
+            test.run();
+            std::cout << "ok      " << test.name << "\n";
+        }
+        catch (const std::exception& e) {
+            failed++;
+            std::cout << "FAILED  " << test.name << ": " << e.what() << "\n";
+        }
+    }
+    if (run == 0) {
+        std::cerr << "No such test\n";
+        return 2;
+    }
+    return failed > 0 ? 1 : 0;
+}
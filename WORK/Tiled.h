@@ -0,0 +1,150 @@
+#pragma once
+#include <opencv2/opencv.hpp>
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "FilterChain.h"
+
+//    PGM (P5)  PPM (P6)  8   .
+//            .
+class PnmReader {
+public:
+    explicit PnmReader(const std::string& path) : file(path, std::ios::binary) {
+        if (!file) {
+            throw std::runtime_error("Failed to open " + path);
+        }
+        std::string magic = readToken();
+        if (magic != "P5" && magic != "P6") {
+            throw std::runtime_error("Tiled mode needs a binary PGM/PPM file: " + path);
+        }
+        channels = magic == "P6" ? 3 : 1;
+        cols = std::stoi(readToken());
+        rows = std::stoi(readToken());
+        if (std::stoi(readToken()) != 255) {
+            throw std::runtime_error("Only 8-bit PGM/PPM is supported: " + path);
+        }
+        file.get(); //     
+        dataOffset = file.tellg();
+    }
+
+    int width() const { return cols; }
+    int height() const { return rows; }
+
+    //   [y, y + count)  dst: PGM -  , PPM - BGR
+    void readRows(int y, int count, cv::Mat& dst) {
+        dst.create(count, cols, CV_8UC(channels));
+        std::streamoff rowBytes = static_cast<std::streamoff>(cols) * channels;
+        file.seekg(dataOffset + rowBytes * y);
+        for (int i = 0; i < count; i++) {
+            file.read(reinterpret_cast<char*>(dst.ptr(i)), rowBytes);
+        }
+        if (!file) {
+            throw std::runtime_error("Unexpected end of PGM/PPM data");
+        }
+        if (channels == 3) {
+            cv::cvtColor(dst, dst, cv::COLOR_RGB2BGR);
+        }
+    }
+
+private:
+    std::string readToken() {
+        std::string token;
+        int c = file.get();
+        while (c != EOF && (std::isspace(c) || c == '#')) {
+            if (c == '#') {
+                while (c != EOF && c != '\n') {
+                    c = file.get(); //    
+                }
+            }
+            c = file.get();
+        }
+        while (c != EOF && !std::isspace(c)) {
+            token += static_cast<char>(c);
+            c = file.get();
+        }
+        file.unget();
+        return token;
+    }
+
+    std::ifstream file;
+    int cols = 0, rows = 0, channels = 0;
+    std::streamoff dataOffset = 0;
+};
+
+//    PGM/PPM  
+class PnmWriter {
+public:
+    PnmWriter(const std::string& path, int width, int height, int type)
+        : file(path, std::ios::binary), channels(CV_MAT_CN(type)) {
+        if (!file || CV_MAT_DEPTH(type) != CV_8U || (channels != 1 && channels != 3)) {
+            throw std::runtime_error("Failed to create " + path);
+        }
+        file << (channels == 3 ? "P6" : "P5") << "\n" << width << " " << height << "\n255\n";
+    }
+
+    void writeRows(const cv::Mat& rows) {
+        cv::Mat data = rows;
+        if (channels == 3) {
+            cv::cvtColor(rows, data, cv::COLOR_BGR2RGB);
+        }
+        for (int i = 0; i < data.rows; i++) {
+            file.write(reinterpret_cast<const char*>(data.ptr(i)), static_cast<std::streamsize>(data.cols) * channels);
+        }
+        if (!file) {
+            throw std::runtime_error("Failed to write PGM/PPM data");
+        }
+    }
+
+private:
+    std::ofstream file;
+    int channels;
+};
+
+//    PNM,   : .pgm  , .ppm  BGR
+inline std::string pnmPath(const std::string& path, int channels) {
+    const size_t dot = path.find_last_of('.');
+    if (dot == std::string::npos || path.find_first_of("/\\", dot) != std::string::npos) {
+        return path;
+    }
+    std::string ext = path.substr(dot);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    if (ext != ".ppm" && ext != ".pgm") {
+        return path;
+    }
+    return path.substr(0, dot) + (channels == 1 ? ".pgm" : ".ppm");
+}
+
+//  ,    ,  .
+//      ,     :
+//     ,      ,
+//   ,        ,    .
+//   -  ,    .
+//  .ppm  .pgm  outputPath      ( - PGM);
+//    .
+inline std::string processTiled(const std::string& inputPath, const std::string& outputPath,
+    const FilterChain& chain, int bandRows = 512) {
+    PnmReader reader(inputPath);
+    std::unique_ptr<PnmWriter> writer; //      
+    std::string path = outputPath;
+    int halo = chain.haloRadius();
+
+    BufferPool pool; //   ,    
+    cv::Mat band;
+    for (int y = 0; y < reader.height(); y += bandRows) {
+        int count = std::min(bandRows, reader.height() - y);
+        int top = std::max(0, y - halo);
+        int bottom = std::min(reader.height(), y + count + halo);
+        reader.readRows(top, bottom - top, band);
+        chain.apply(band, pool);
+        if (!writer) {
+            path = pnmPath(outputPath, band.channels());
+            writer = std::make_unique<PnmWriter>(path, reader.width(), reader.height(), band.type());
+        }
+        writer->writeRows(band.rowRange(y - top, y - top + count));
+    }
+    return path;
+}
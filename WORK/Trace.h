@@ -0,0 +1,213 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+//     ( , )
+struct TraceStats {
+    std::string name;
+    size_t count = 0;
+    double totalMs = 0;
+    double p50Ms = 0;
+    double p99Ms = 0;
+    size_t bytes = 0; //    ,    
+};
+
+//    .
+//   , TRACE_SCOPE        .
+//    (setEnabled),  --trace     
+// WORK_TRACE=:          
+// Chrome trace events (  chrome://tracing  Perfetto).
+class Tracer {
+public:
+    typedef std::chrono::steady_clock Clock;
+
+    static Tracer& instance() {
+        static Tracer tracer;
+        return tracer;
+    }
+
+    bool enabled() const { return isEnabled.load(std::memory_order_relaxed); }
+    void setEnabled(bool value) { isEnabled.store(value, std::memory_order_relaxed); }
+
+    //     ;    path  writeTrace   
+    void startTrace(const std::string& path) {
+        std::lock_guard<std::mutex> lock(mutex);
+        tracePath = path;
+        setEnabled(true);
+    }
+
+    void record(const char* name, Clock::time_point start, Clock::time_point end, size_t bytes) {
+        double ms = std::chrono::duration<double, std::milli>(end - start).count();
+        int thread = threadIndex();
+        std::lock_guard<std::mutex> lock(mutex);
+        Series& series = series_[name];
+        series.count++;
+        series.totalMs += ms;
+        series.bytes += bytes;
+        //     
+        if (series.samples.size() < MAX_SAMPLES) {
+            series.samples.push_back(ms);
+        }
+        else {
+            series.samples[series.count % MAX_SAMPLES] = ms;
+        }
+        if (!tracePath.empty() && events.size() < MAX_EVENTS) {
+            events.push_back({ name, start, end, thread });
+        }
+    }
+
+    std::vector<TraceStats> stats() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<TraceStats> result;
+        for (const auto& item : series_) {
+            TraceStats stats;
+            stats.name = item.first;
+            stats.count = item.second.count;
+            stats.totalMs = item.second.totalMs;
+            stats.bytes = item.second.bytes;
+            std::vector<double> samples = item.second.samples;
+            std::sort(samples.begin(), samples.end());
+            if (!samples.empty()) {
+                stats.p50Ms = samples[samples.size() / 2];
+                stats.p99Ms = samples[std::min(samples.size() - 1, samples.size() * 99 / 100)];
+            }
+            result.push_back(stats);
+        }
+        return result;
+    }
+
+    void printStats(std::ostream& out) const {
+        out << std::left << std::setw(28) << "stage" << std::right << std::setw(8) << "count" << std::setw(12) << "total ms"
+            << std::setw(10) << "p50 ms" << std::setw(10) << "p99 ms" << std::setw(12) << "MB" << "\n";
+        for (const TraceStats& stats : this->stats()) {
+            out << std::left << std::setw(28) << stats.name << std::right << std::setw(8) << stats.count
+                << std::fixed << std::setprecision(2) << std::setw(12) << stats.totalMs << std::setw(10) << stats.p50Ms
+                << std::setw(10) << stats.p99Ms << std::setw(12) << stats.bytes / 1048576.0 << std::defaultfloat << "\n";
+        }
+    }
+
+    void reset() {
+        std::lock_guard<std::mutex> lock(mutex);
+        series_.clear();
+        events.clear();
+    }
+
+    //      Chrome trace events
+    bool writeTrace() const {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (tracePath.empty()) {
+            return false;
+        }
+        std::ofstream file(tracePath);
+        file << "{\"traceEvents\":[\n";
+        for (size_t i = 0; i < events.size(); i++) {
+            const Event& event = events[i];
+            file << (i ? ",\n" : "") << "{\"name\":\"" << event.name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << event.thread
+                << ",\"ts\":" << microseconds(event.start) << ",\"dur\":" << microseconds(event.end) - microseconds(event.start) << "}";
+        }
+        file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+        return static_cast<bool>(file);
+    }
+
+private:
+    enum { MAX_SAMPLES = 4096, MAX_EVENTS = 1 << 20 };
+
+    struct Series {
+        size_t count = 0;
+        double totalMs = 0;
+        size_t bytes = 0;
+        std::vector<double> samples;
+    };
+
+    struct Event {
+        const char* name; //   -  
+        Clock::time_point start, end;
+        int thread;
+    };
+
+    Tracer() : origin(Clock::now()) {
+        std::string path = environment("WORK_TRACE");
+        if (!path.empty()) {
+            startTrace(path);
+        }
+    }
+
+    ~Tracer() {
+        writeTrace();
+    }
+
+    static std::string environment(const char* name) {
+#ifdef _MSC_VER
+        char* value = nullptr;
+        size_t length = 0;
+        std::string result;
+        if (_dupenv_s(&value, &length, name) == 0 && value) {
+            result = value;
+        }
+        free(value);
+        return result;
+#else
+        const char* value = std::getenv(name);
+        return value ? value : "";
+#endif
+    }
+
+    static int threadIndex() {
+        static std::atomic<int> next(0);
+        thread_local int index = ++next;
+        return index;
+    }
+
+    long long microseconds(Clock::time_point time) const {
+        return std::chrono::duration_cast<std::chrono::microseconds>(time - origin).count();
+    }
+
+    std::atomic<bool> isEnabled{ false };
+    mutable std::mutex mutex;
+    std::map<std::string, Series> series_;
+    std::vector<Event> events;
+    std::string tracePath;
+    Clock::time_point origin;
+};
+
+//      
+class ScopedTimer {
+public:
+    explicit ScopedTimer(const char* name, size_t bytes = 0) : name(name), bytes(bytes), active(Tracer::instance().enabled()) {
+        if (active) {
+            start = Tracer::Clock::now();
+        }
+    }
+
+    ~ScopedTimer() {
+        if (active) {
+            Tracer::instance().record(name, start, Tracer::Clock::now(), bytes);
+        }
+    }
+
+    //  ,   
+    void addBytes(size_t value) { bytes += value; }
+
+    ScopedTimer(const ScopedTimer&) = delete;
+    ScopedTimer& operator=(const ScopedTimer&) = delete;
+
+private:
+    const char* name;
+    size_t bytes;
+    bool active;
+    Tracer::Clock::time_point start;
+};
+
+#define TRACE_CONCAT_INNER(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_INNER(a, b)
+//    -: TRACE_SCOPE("color")
+#define TRACE_SCOPE(name) ScopedTimer TRACE_CONCAT(traceScope, __LINE__)(name)